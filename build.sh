@@ -6,8 +6,10 @@ name=spxe
 
 lib=lib$name
 header=$name.h
+headerpp=$name.hpp
 obj=$name.o
 libs=(-lglfw)
+x11libs=(-lX11 -lXext -lm -lpthread)
 std=-std=c89
 opt=-O2
 
@@ -28,7 +30,7 @@ if echo "$OSTYPE" | grep -q "darwin"; then
     dlib=(-dynamiclib)
     suffix=dylib
 elif echo "$OSTYPE" | grep -q "linux"; then
-    libs+=(-lm -lGL -lGLEW)
+    libs+=(-lm -lGL -lGLEW -lpthread)
     dlib=(-fPIC -shared)
     suffix=so
 fi
@@ -41,6 +43,10 @@ compile() {
     cmd $cc ${cflags[*]} -I. ${libs[*]} $1 -o $exe 
 }
 
+x11() {
+    cmd $cc ${cflags[*]} -DSPXE_X11 -I. $1 ${x11libs[*]} -o $exe
+}
+
 object() {
     cmd $cc ${cflags[*]} -x c -DSPXE_APPLICATION -c $header -o $obj
 }
@@ -64,12 +70,19 @@ clean() {
     cleanf $lib.$suffix
 }
 
+check() {
+    for f in tests/*.c; do
+        cmd $cc ${cflags[*]} -I. $f ${libs[*]} -o $exe && ./$exe || return 1
+    done
+}
+
 install() {
     [ "$EUID" -ne 0 ] && echo "run with 'sudo' to install" && exit
     [ -f $obj ] || object
     [ -f $lib.$suffix ] || shared
     [ -f $lib.a ] || static
     cmd cp $header $incpath
+    cmd cp $headerpp $incpath
     cmd cp $lib.$suffix $libpath
     cmd cp $lib.a $libpath
     return 0
@@ -78,6 +91,7 @@ install() {
 uninstall() {
     [ "$EUID" -ne 0 ] && echo "run with 'sudo' to uninstall" && exit
     cleanf $incpath/$header
+    cleanf $incpath/$headerpp
     cleanf $libpath/$lib.$suffix
     cleanf $libpath/$lib.a
     return 0
@@ -89,6 +103,8 @@ usage() {
     echo -e "shared\t\t: build $name as a shared library: $lib.$suffix"
     echo -e "static\t\t: build $name as a static library: $lib.a"
     echo -e "test\t\t: test compilation of all example files"
+    echo -e "check\t\t: compile and run the tests in tests/"
+    echo -e "x11 [source]\t: compile <source> or all examples with the X11 backend"
     echo -e "all\t\t: build $name as shared and static libraries"
     echo -e "help\t\t: print usage information and available commands"
     echo -e "clean\t\t: delete local builds and executables"
@@ -105,6 +121,10 @@ case "$1" in
         object && static;;
     "test")
         for f in examples/*.c; do compile $f; done;;
+    "check")
+        check;;
+    "x11")
+        if [ -n "$2" ]; then x11 $2; else for f in examples/*.c; do x11 $f || exit 1; done; fi;;
     "all")
         object && shared && static;;
     "help")
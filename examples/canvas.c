@@ -0,0 +1,64 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+
+#define WIDTH 320
+#define HEIGHT 240
+#define WORLD 4096
+#define SPEED 4
+
+static void pxWorld(Px* world)
+{
+    int x, y;
+    for (y = 0; y < WORLD; ++y) {
+        Px* row = world + (size_t)y * WORLD;
+        for (x = 0; x < WORLD; ++x) {
+            row[x].r = (unsigned char)(x ^ y);
+            row[x].g = (unsigned char)(x >> 5);
+            row[x].b = (unsigned char)(y >> 5);
+            row[x].a = 255;
+        }
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    Px* world;
+    int x = 0, y = 0, mousex, mousey;
+    const Px white = {255, 255, 255, 255};
+
+    Px* pixbuf = spxeStart("canvas", 800, 600, WIDTH, HEIGHT);
+    if (!pixbuf) {
+        return 1;
+    }
+
+    /* a file keeps what was painted between runs, only new ones are generated */
+    world = spxeCanvas(WORLD, WORLD, argc > 1 ? argv[1] : NULL);
+    if (!world) {
+        spxeEnd(pixbuf);
+        return 1;
+    }
+    if (!world[0].a) {
+        pxWorld(world);
+    }
+
+    while (spxeRun(world)) {
+        if (spxeKeyPressed(KEY_ESCAPE)) {
+            break;
+        }
+
+        x += SPEED * (spxeKeyDown(KEY_RIGHT) - spxeKeyDown(KEY_LEFT));
+        y += SPEED * (spxeKeyDown(KEY_UP) - spxeKeyDown(KEY_DOWN));
+        spxeViewport(x, y);
+        spxeViewportPos(&x, &y);
+
+        /* mouse positions are in world coordinates */
+        spxeMousePos(&mousex, &mousey);
+        if (spxeMouseDown(MOUSE_LEFT) &&
+            mousex >= 0 && mousex < WORLD && mousey >= 0 && mousey < WORLD) {
+            world[(size_t)mousey * WORLD + mousex] = white;
+        }
+    }
+
+    spxeCanvasClose(world);
+    return spxeEnd(pixbuf);
+}
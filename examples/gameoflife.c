@@ -9,11 +9,11 @@
 static const Px black = {0, 0, 0, 255};
 static const Px white = {255, 255, 255, 255};
 
-static void pxInit(Px* pixbuf, const size_t size)
+static void pxInit(Px* pixbuf, const size_t size, const unsigned int seed)
 {
     size_t i;
     for (i = 0; i < size; ++i) {
-        memcpy(pixbuf + i, rand() % 2 ? &white : &black, sizeof(Px));
+        memcpy(pixbuf + i, spxeRandom(seed, (unsigned int)i) & 1 ? &white : &black, sizeof(Px));
     }
 }
 
@@ -38,25 +38,29 @@ static void pxUpdate(Px* pixbuf, Px* buf, const int width, const int height)
                         (count == 3 ? white : black);
         }
     }
-
-    memcpy(pixbuf, buf, width * height * sizeof(Px));
 }
 
 int main(const int argc, char** argv)
 {
-    Px* pixbuf, *buf;
+    Px* pixbuf;
     const Px red = {255, 0, 0, 255};
     int mousex, mousey, width = 320, height = 240;
+    unsigned int seed = (unsigned int)time(NULL);
     
     if (argc > 1) {
         width = atoi(argv[1]);
         height = argc > 2 ? atoi(argv[2]) : width;
     }
 
-    srand(time(NULL));
     pixbuf = spxeStart("game of life", 800, 600, width, height);
-    buf = (Px*)malloc(width * height * sizeof(Px));
-    pxInit(pixbuf, width * height);
+    if (!pixbuf) {
+        return 1;
+    }
+    if (!spxeBuffers(2)) {
+        spxeEnd(pixbuf);
+        return 1;
+    }
+    pxInit(pixbuf, width * height, seed);
 
     while (spxeRun(pixbuf)) {
         spxeMousePos(&mousex, &mousey);
@@ -64,16 +68,17 @@ int main(const int argc, char** argv)
             break;
         }
         if (spxeKeyPressed(KEY_R)) {
-            pxInit(pixbuf, width * height);
+            pxInit(pixbuf, width * height, ++seed);
         }
         
-        pxUpdate(pixbuf, buf, width, height);
+        /* the next state is drawn in the other buffer, which becomes current */
+        pxUpdate(pixbuf, spxeBuffer(1), width, height);
+        pixbuf = spxeSwap();
         if (mousex >= 0 && mousex < width && mousey >= 0 && mousey < height) {
             pixbuf[mousey * width + mousex] = red;
         }
     }
     
-    free(buf);
     return spxeEnd(pixbuf);
 }
 
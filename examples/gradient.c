@@ -26,8 +26,11 @@ int main(void)
 {
     Px* pixbuf = spxeStart("gradient", 800, 600, WIDTH, HEIGHT);
     spxeDrawGradient(pixbuf);
+
+    /* the gradient never changes, wait for input instead of drawing it again */
+    spxeIdle(1.0, 1);
     while (spxeRun(pixbuf)) {
-        if(spxeKeyPressed(ESCAPE)) {
+        if (spxeKeyPressed(KEY_ESCAPE)) {
             break;
         }
     }
@@ -1,11 +1,10 @@
 #define SPXE_APPLICATION
 #include <spxe.h>
 #include <stdlib.h>
-#include <string.h>
 #include <math.h>
 
 #define ITERS 50
-#define CLAMP(f) (double)(((f) > 1.0) + f * ((f) >= 0.0 && (f) <= 1.0))
+#define BANDS 8
 
 typedef struct vec2 {
     double x, y;
@@ -41,16 +40,18 @@ static double vec2_dot(const vec2 a, const vec2 b)
     return a.x * b.x + a.y * b.y;
 }
 
-static void pxDraw(Px* px, const double n, const double t)
+/* float framebuffer, clamped by spxe on the GPU */
+static void pxDraw(float* px, const double n, const double t)
 {
-    px->r = (unsigned)(CLAMP(sin(t) * n * 0.8 + 0.2) * 255.0);
-    px->g = (unsigned)(CLAMP(sin(t * 0.333333) * n) * 255.0);
-    px->b = (unsigned)(CLAMP(cos(t * 0.7) * n * 0.8 + 0.2) * 255.0);
+    px[0] = (float)(sin(t) * n * 0.8 + 0.2);
+    px[1] = (float)(sin(t * 0.333333) * n);
+    px[2] = (float)(cos(t * 0.7) * n * 0.8 + 0.2);
 }
 
-static void pxUpdate(Px* pixbuf, const int width, const int height, vec2 pos, double t)
+static void pxUpdate(float* pixbuf, const int width, const int height, vec2 pos, double t)
 {
     int i, x, y;
+    const int band = (height + BANDS - 1) / BANDS;
 
     pos.x = (pos.x + pos.x * zoom) * 0.5;
     pos.y = (pos.y + pos.y * zoom) * 0.5;
@@ -75,15 +76,21 @@ static void pxUpdate(Px* pixbuf, const int width, const int height, vec2 pos, do
                 }
             }
             
-            pxDraw(pixbuf + width * y + x, n, t);
+            pxDraw(pixbuf + (width * y + x) * 4, n, t);
+        }
+
+        /* a finished band is uploaded while the next one is computed */
+        if ((y + 1) % band == 0 || y + 1 == height) {
+            spxeBand((Px*)pixbuf, y - y % band, y % band + 1);
         }
     }
 }
 
 int main(const int argc, const char** argv)
 {
+    int i;
     double t;
-    Px* pixbuf;
+    float* pixbuf;
     vec2 pos = {0.0, 0.0};
     int width = 64, height = 64;
 
@@ -92,11 +99,19 @@ int main(const int argc, const char** argv)
         height = argc > 2 ? atoi(argv[2]) : width;
     }
   
-    pixbuf = spxeStart("mandelbrot", 800, 600, width, height);
-    memset(pixbuf, 255, width * height * sizeof(Px));
+    spxeHint(SPXE_FORMAT, SPXE_RGBA32F);
+    pixbuf = (float*)spxeStart("mandelbrot", 800, 600, width, height);
+    if (!pixbuf) {
+        fprintf(stderr, "could not init spxe\n");
+        return 1;
+    }
+
+    for (i = 0; i < width * height * 4; ++i) {
+        pixbuf[i] = 1.0F;
+    }
     t = spxeTime();
 
-    while (spxeRun(pixbuf)) { 
+    while (spxeRun((Px*)pixbuf)) { 
         double dT, T = spxeTime();
         dT = (T - t) * 50.0;
         t = T;
@@ -126,6 +141,6 @@ int main(const int argc, const char** argv)
         pxUpdate(pixbuf, width, height, pos, t);
     }
 
-    return spxeEnd(pixbuf);
+    return spxeEnd((Px*)pixbuf);
 }
 
@@ -0,0 +1,63 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <stdlib.h>
+
+#define WIDTH 640
+#define HEIGHT 360
+#define COUNT 1000000
+#define RATE 20000
+
+static float pxRandom(const float min, const float max)
+{
+    return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+int main(void)
+{
+    int i, x = WIDTH / 2, y = HEIGHT / 4;
+    const Px black = {0, 0, 0, 255};
+    spxeParticles* particles;
+
+    Px* pixbuf = spxeStart("particles", 1280, 720, WIDTH, HEIGHT);
+    if (!pixbuf) {
+        return 1;
+    }
+
+    particles = spxeParticlesCreate(COUNT);
+    if (!particles) {
+        spxeEnd(pixbuf);
+        return 1;
+    }
+
+    while (spxeRun(pixbuf)) {
+        if (spxeKeyPressed(KEY_ESCAPE)) {
+            break;
+        }
+        if (spxeMouseDown(MOUSE_LEFT)) {
+            spxeMousePos(&x, &y);
+        }
+
+        /* a fountain of dim particles that add up where they overlap */
+        for (i = 0; i < RATE; ++i) {
+            Px color;
+            color.r = (unsigned char)(8 + rand() % 24);
+            color.g = (unsigned char)(4 + rand() % 12);
+            color.b = (unsigned char)(rand() % 8);
+            color.a = 255;
+            spxeParticlesEmit(
+                particles, (float)x, (float)y,
+                pxRandom(-40.0F, 40.0F), pxRandom(80.0F, 200.0F),
+                color, pxRandom(1.0F, 3.0F)
+            );
+        }
+
+        spxeParticlesUpdate(particles, 1.0F / 60.0F, 0.0F, -98.0F);
+        for (i = 0; i < spxeStride() * HEIGHT; ++i) {
+            pixbuf[i] = black;
+        }
+        spxeParticlesDraw(particles, pixbuf, WIDTH, HEIGHT, spxeStride(), 1);
+    }
+
+    spxeParticlesFree(particles);
+    return spxeEnd(pixbuf);
+}
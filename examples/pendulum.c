@@ -75,10 +75,11 @@ int main(const int argc, const char** argv)
     const Px red = {255, 0, 0, 255}, green = {0, 255, 0, 255};
     
     size_t size;
-    vec2 xy, dif, cross;
+    vec2 xy, prev, dif, cross;
     ivec2 p, center, idif;
     bmp4 fb = {NULL, 200, 150};
-    float invDist, dT, T, t, v = 0.0f;
+    const float dT = 1.0F / 60.0F;
+    float invDist, alpha, v = 0.0f;
 
     if (argc > 1) {
         fb.width = atoi(argv[1]);
@@ -90,28 +91,31 @@ int main(const int argc, const char** argv)
     center = ivec2_create(fb.width / 2, fb.height / 2);
     p = ivec2_create(center.x + fb.width / 8, center.y);
     xy = vec2_create((float)p.x, (float)p.y);
+    prev = xy;
+    cross = vec2_create(0.0F, 0.0F);
 
     idif = ivec2_create(p.x - center.x, p.y - center.y);
     invDist = 1.0F / sqrt(idif.x * idif.x + idif.y * idif.y);
-    t = spxeTime();
+    spxeTimestep(dT, 8);
 
     while (spxeRun(fb.pixbuf)) {
-        T = spxeTime();
-        dT = (T - t);
-        t = T;
-
         if (spxeKeyPressed(KEY_ESCAPE)) {
             break;
         }
 
-        dif = vec2_create((float)(p.x - center.x), (float)(p.y - center.y));
-        cross = vec2_create(dif.y * invDist, dif.x * invDist);
-        
-        v -= cross.y;
-        xy.x -= cross.x * v * dT;
-        xy.y += cross.y * v * dT;
-        p.x = (int)xy.x;
-        p.y = (int)xy.y;
+        while (spxeUpdate()) {
+            dif = vec2_create(xy.x - (float)center.x, xy.y - (float)center.y);
+            cross = vec2_create(dif.y * invDist, dif.x * invDist);
+            
+            prev = xy;
+            v -= cross.y;
+            xy.x -= cross.x * v * dT;
+            xy.y += cross.y * v * dT;
+        }
+
+        alpha = (float)spxeAlpha();
+        p.x = (int)(prev.x + (xy.x - prev.x) * alpha);
+        p.y = (int)(prev.y + (xy.y - prev.y) * alpha);
 
         memset(fb.pixbuf, 155, size);
         if (p.x >= 0 && p.y >= 0 && p.x < fb.width && p.y < fb.height) {
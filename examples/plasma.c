@@ -0,0 +1,58 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <string.h>
+
+#define WIDTH 160
+#define HEIGHT 120
+
+/* runs on the GPU under the pixel buffer, pixels with alpha 0 let it through */
+static const char* plasma =
+"void main(void) {\n"
+"    vec2 p = TexCoords * resolution / 16.;\n"
+"    float t = time * params[0].x;\n"
+"    float v = sin(p.x + t) + sin(p.y + t * .5) + sin(length(p - 4.) - t);\n"
+"    FragColor = vec4(.5 + .5 * sin(v), .5 + .5 * sin(v + 2.), .5 + .5 * sin(v + 4.), 1.);\n"
+"}\n";
+
+int main(void)
+{
+    int program, x, y;
+    float params[4] = {1.0F, 0.0F, 0.0F, 0.0F};
+    const Px white = {255, 255, 255, 255};
+
+    Px* pixbuf = spxeStart("plasma", 800, 600, WIDTH, HEIGHT);
+    if (!pixbuf) {
+        return 1;
+    }
+
+    program = spxeProgram(plasma, SPXE_UNDER);
+    if (!program) {
+        spxeEnd(pixbuf);
+        return 1;
+    }
+
+    while (spxeRun(pixbuf)) {
+        if (spxeKeyPressed(KEY_ESCAPE)) {
+            break;
+        }
+        if (spxeKeyPressed(KEY_UP)) {
+            params[0] *= 2.0F;
+        }
+        if (spxeKeyPressed(KEY_DOWN)) {
+            params[0] *= 0.5F;
+        }
+        if (spxeKeyPressed(KEY_C)) {
+            memset(pixbuf, 0, WIDTH * HEIGHT * sizeof(Px));
+        }
+
+        spxeProgramParams(program, params, 4);
+
+        /* draw on top of the plasma with the mouse */
+        spxeMousePos(&x, &y);
+        if (spxeMouseDown(MOUSE_LEFT) && x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT) {
+            pixbuf[y * WIDTH + x] = white;
+        }
+    }
+
+    return spxeEnd(pixbuf);
+}
@@ -0,0 +1,62 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <math.h>
+
+#define WIDTH 320
+#define HEIGHT 240
+#define SIZE 256
+
+static void pxTexture(Px* texture)
+{
+    int x, y;
+    for (y = 0; y < SIZE; ++y) {
+        for (x = 0; x < SIZE; ++x) {
+            Px* p = texture + y * SIZE + x;
+            p->r = (unsigned char)(x ^ y);
+            p->g = (unsigned char)((x / 32 + y / 32) % 2 ? 200 : 40);
+            p->b = (unsigned char)y;
+            p->a = 255;
+        }
+    }
+}
+
+int main(void)
+{
+    int i, filter = SPXE_NEAREST;
+    float matrix[6];
+    static Px texture[SIZE * SIZE];
+    const Px black = {0, 0, 0, 255};
+
+    Px* pixbuf = spxeStart("rotozoom", 800, 600, WIDTH, HEIGHT);
+    if (!pixbuf) {
+        return 1;
+    }
+    pxTexture(texture);
+
+    while (spxeRun(pixbuf)) {
+        const float t = (float)spxeTime();
+        const float scale = 0.75F + 0.5F * (float)sin(t * 0.5F);
+        const float c = (float)cos(t) * scale, s = (float)sin(t) * scale;
+        if (spxeKeyPressed(KEY_ESCAPE)) {
+            break;
+        }
+        if (spxeKeyPressed(KEY_SPACE)) {
+            filter = filter == SPXE_NEAREST ? SPXE_BILINEAR : SPXE_NEAREST;
+        }
+
+        /* rotate and scale around the center of the texture, then center it on screen */
+        matrix[0] = c;
+        matrix[1] = -s;
+        matrix[2] = WIDTH / 2 - (c - s) * SIZE / 2;
+        matrix[3] = s;
+        matrix[4] = c;
+        matrix[5] = HEIGHT / 2 - (s + c) * SIZE / 2;
+
+        for (i = 0; i < spxeStride() * HEIGHT; ++i) {
+            pixbuf[i] = black;
+        }
+        spxeBlitAffine(pixbuf, WIDTH, HEIGHT, spxeStride(), texture, SIZE, SIZE, SIZE, matrix, filter);
+    }
+
+    return spxeEnd(pixbuf);
+}
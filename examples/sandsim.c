@@ -9,16 +9,17 @@ static const Px sand = {125, 125, 0, 255};
 static Px pxAir(const int height, int y)
 {
     Px air = {100, 100, 130, 255};
-    air.b += (uint8_t)(int)(125.0 * ((float)y / (float)height));
+    air.b += (unsigned char)(int)(125.0 * ((float)y / (float)height));
     return air;
 }
 
-static void pxInit(Px* pixbuf, const int width, const int height)
+static void pxInit(Px* pixbuf, const int width, const int height, const unsigned int seed)
 {
     int x, y, index = 0;
     for (y = 0; y < height; ++y) {
         for (x = 0; x < width; ++x, ++index) {
-            pixbuf[index] = y < height / 3 - (rand() % 40) ? sand: pxAir(height, y);
+            const int depth = (int)(spxeRandom(seed, (unsigned int)index) % 40);
+            pixbuf[index] = y < height / 3 - depth ? sand: pxAir(height, y);
         }
     }
 }
@@ -29,6 +30,7 @@ static void pxUpdate(Px* pixbuf, Px* buf, const int width, const int height)
     for (y = 0; y < height; ++y) {
         for (x = 0; x < width; ++x, ++index) { 
             if (pixbuf[index].r > 124) {
+                buf[index] = pixbuf[index];
                 if (y > 0) {
                     dy = (y - 1) * width;
                     if (pixbuf[dy + x].r < 125) {
@@ -46,43 +48,74 @@ static void pxUpdate(Px* pixbuf, Px* buf, const int width, const int height)
             else buf[index] = pxAir(height, y);
         }
     }
-
-    memcpy(pixbuf, buf, width * height * sizeof(Px));
 }
 
 int main(const int argc, const char** argv)
 {
-    Px* pixbuf, *buf;
+    Px* pixbuf;
+    spxeStream* stream = NULL;
     const Px red = {255, 0, 0, 255};
-    int mousex, mousey, width = 160, height = 120;
+    int mousex, mousey, width = 160, height = 120, rewind = 0;
+    unsigned int seed = (unsigned int)time(NULL);
     
     if (argc > 1) {
         width = atoi(argv[1]);
         height = argc > 2 ? atoi(argv[2]) : width;
     }
 
-    srand(time(NULL));
     pixbuf = spxeStart("sandsim", 800, 600, width, height);
-    buf = (Px*)malloc(width * height * sizeof(Px));
-    pxInit(pixbuf, width, height);
+    if (!pixbuf) {
+        return 1;
+    }
+    if (!spxeBuffers(2)) {
+        spxeEnd(pixbuf);
+        return 1;
+    }
+    pxInit(pixbuf, width, height, seed);
+    spxeHistory(10.0, 64 << 20);
+
+    /* a third argument streams the frames to viewers at that address */
+    if (argc > 3) {
+        stream = spxeStreamCreate(argv[3], width, height);
+    }
 
     while (spxeRun(pixbuf)) {
+        if (stream) {
+            spxeStreamPublish(stream, pixbuf, width);
+        }
         spxeMousePos(&mousex, &mousey);
         if (spxeKeyPressed(KEY_ESCAPE) || spxeKeyPressed(KEY_Q)) {
             break;
         }
         if (spxeKeyPressed(KEY_R)) {
-            pxInit(pixbuf, width, height);
+            pxInit(pixbuf, width, height, ++seed);
+        }
+
+        /* holding backspace plays the last seconds backwards, the simulation resumes from there */
+        spxeHistoryPause(spxeKeyDown(KEY_BACKSPACE));
+        if (spxeKeyDown(KEY_BACKSPACE)) {
+            const Px* frame = spxeHistoryFrame(rewind, NULL, NULL, NULL);
+            if (frame) {
+                memcpy(pixbuf, frame, (size_t)width * height * sizeof(Px));
+            }
+            rewind += rewind + 1 < spxeHistoryCount();
+            continue;
+        }
+        if (rewind) {
+            spxeHistoryDrop(rewind);
+            rewind = 0;
         }
         
-        pxUpdate(pixbuf, buf, width, height);
+        /* the next state is drawn in the other buffer, which becomes current */
+        pxUpdate(pixbuf, spxeBuffer(1), width, height);
+        pixbuf = spxeSwap();
         if (spxeMouseDown(MOUSE_LEFT) && 
             mousex >= 0 && mousex < width && mousey >= 0 && mousey < height) {
             pixbuf[mousey * width + mousex] = red;
         }
     }
     
-    free(buf);
+    spxeStreamClose(stream);
     return spxeEnd(pixbuf);
 }
 
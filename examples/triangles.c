@@ -0,0 +1,87 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define WIDTH 320
+#define HEIGHT 240
+#define SIZE 80.0F
+
+static const float corners[8][3] = {
+    {-1.0F, -1.0F, -1.0F}, {1.0F, -1.0F, -1.0F}, {1.0F, 1.0F, -1.0F}, {-1.0F, 1.0F, -1.0F},
+    {-1.0F, -1.0F, 1.0F}, {1.0F, -1.0F, 1.0F}, {1.0F, 1.0F, 1.0F}, {-1.0F, 1.0F, 1.0F}
+};
+
+static const int faces[12][3] = {
+    {0, 1, 2}, {0, 2, 3}, {4, 6, 5}, {4, 7, 6},
+    {0, 4, 5}, {0, 5, 1}, {3, 2, 6}, {3, 6, 7},
+    {0, 3, 7}, {0, 7, 4}, {1, 5, 6}, {1, 6, 2}
+};
+
+/* a cube turning around two axes, its corners colored by their position */
+static void pxCube(spxeVertex* vertices, const float t)
+{
+    int i, j;
+    spxeVertex projected[8];
+    const float ca = (float)cos(t), sa = (float)sin(t);
+    const float cb = (float)cos(t * 0.7F), sb = (float)sin(t * 0.7F);
+
+    for (i = 0; i < 8; ++i) {
+        const float* p = corners[i];
+        const float x = p[0] * ca - p[2] * sa, z = p[0] * sa + p[2] * ca;
+        const float y = p[1] * cb - z * sb, w = p[1] * sb + z * cb;
+        projected[i].x = WIDTH / 2 + x * SIZE;
+        projected[i].y = HEIGHT / 2 + y * SIZE;
+        projected[i].z = 0.5F + w * 0.25F;
+        projected[i].color.r = (unsigned char)(p[0] > 0.0F ? 255 : 32);
+        projected[i].color.g = (unsigned char)(p[1] > 0.0F ? 255 : 32);
+        projected[i].color.b = (unsigned char)(p[2] > 0.0F ? 255 : 32);
+        projected[i].color.a = 255;
+    }
+
+    for (i = 0; i < 12; ++i) {
+        for (j = 0; j < 3; ++j) {
+            vertices[i * 3 + j] = projected[faces[i][j]];
+        }
+    }
+}
+
+int main(void)
+{
+    int i;
+    size_t size;
+    spxeVertex vertices[36];
+    unsigned short* depth;
+    const Px black = {0, 0, 0, 255};
+
+    Px* pixbuf = spxeStart("triangles", 800, 600, WIDTH, HEIGHT);
+    if (!pixbuf) {
+        return 1;
+    }
+
+    /* the depth buffer has the same stride as the pixel buffer */
+    size = (size_t)spxeStride() * HEIGHT * sizeof(unsigned short);
+    depth = (unsigned short*)malloc(size);
+    if (!depth) {
+        spxeEnd(pixbuf);
+        return 1;
+    }
+
+    while (spxeRun(pixbuf)) {
+        if (spxeKeyPressed(KEY_ESCAPE)) {
+            break;
+        }
+
+        for (i = 0; i < spxeStride() * HEIGHT; ++i) {
+            pixbuf[i] = black;
+        }
+        memset(depth, 0xff, size);
+
+        pxCube(vertices, (float)spxeTime());
+        spxeTriangles(pixbuf, depth, 16, WIDTH, HEIGHT, spxeStride(), vertices, 36);
+    }
+
+    free(depth);
+    return spxeEnd(pixbuf);
+}
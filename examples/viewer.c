@@ -0,0 +1,49 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <string.h>
+
+/* shows the frames streamed by a spxeStreamCreate() server, such as sandsim */
+int main(const int argc, const char** argv)
+{
+    Px* pixbuf;
+    const Px* frame;
+    spxeStream* stream;
+    unsigned long sequence, shown = 0;
+    int y, width, height;
+
+    stream = spxeStreamOpen(argc > 1 ? argv[1] : "/tmp/spxe.sock");
+    if (!stream) {
+        return 1;
+    }
+    spxeStreamSize(stream, &width, &height);
+
+    pixbuf = spxeStart("viewer", 800, 600, width, height);
+    if (!pixbuf) {
+        spxeStreamClose(stream);
+        return 1;
+    }
+
+    while (spxeRun(pixbuf)) {
+        if (spxeKeyPressed(KEY_ESCAPE)) {
+            break;
+        }
+
+        /* NULL after the first frame means the server went away */
+        frame = spxeStreamFrame(stream, &sequence);
+        if (!frame && sequence) {
+            break;
+        }
+        if (frame && sequence != shown) {
+            for (y = 0; y < height; ++y) {
+                memcpy(
+                    pixbuf + (size_t)y * spxeStride(),
+                    frame + (size_t)y * width, width * sizeof(Px)
+                );
+            }
+            shown = sequence;
+        }
+    }
+
+    spxeStreamClose(stream);
+    return spxeEnd(pixbuf);
+}
@@ -53,8 +53,9 @@ On Windows and Linux you also need GLEW.
 ************** OS compliation flags ***************
 
 MacOS:      -framework OpenGL -lglfw
-Linux:      -lGL -lGLEW -lglfw
+Linux:      -lGL -lGLEW -lglfw -lpthread
 Windows:    -lopengl32 -lglfw3dll -lglew32
+X11:        -DSPXE_X11 -lX11 -lXext
 
 *************** Hello World Example ****************
 
@@ -97,10 +98,58 @@ Px*     spxeStart(          const char* title,
 void    spxeScreenSize(     int*        widthptr,   int*        heightptr   );
 void    spxeWindowSize(     int*        widthptr,   int*        heightptr   );
 void    spxeBackgroundColor(const Px    px                                  );
+int     spxeStride(         void                                            );
+
+/* framebuffer hints, set before spxeStart() */
+void    spxeHint(           const int   hint,       const int   value       );
+
+/* floating point framebuffers */
+void    spxeToneMap(        const float exposure,   const int   tonemap,
+                            const int   srgb                                );
+unsigned short spxeHalf(    const float f                                   );
+
+/* gpu pixel programs */
+int     spxeProgram(        const char* source,     const int   layer       );
+void    spxeProgramParams(  const int   program,
+                            const float* params,    const int   count       );
+
+/* managed framebuffers, swapped without copies */
+int     spxeBuffers(        const int   count                               );
+Px*     spxeBuffer(         const int   index                               );
+Px*     spxeSwap(           void                                            );
+
+/* virtual canvas, the screen is a movable viewport into it */
+Px*     spxeCanvas(         const int   width,      const int   height,
+                            const char* path                                );
+void    spxeCanvasClose(    Px*         canvas                              );
+void    spxeViewport(       const int   x,          const int   y           );
+void    spxeViewportPos(    int*        xptr,       int*        yptr        );
+
+/* idle mode, unchanged frames are not drawn again */
+void    spxeIdle(           const double timeout,   const int   hash        );
+void    spxeRedraw(         void                                            );
+
+/* banded rendering, finished rows are uploaded while the next ones are drawn */
+void    spxeBand(           const Px*   pixbuf,
+                            const int   y,          const int   rows        );
+
+/* dynamic resolution */
+void    spxeResolutionBudget(const double seconds,
+                            const int   minwidth,   const int   minheight   );
+int     spxeScreenResized(  Px**        pixbufptr                           );
 
 /* time input */
 double  spxeTime(           void                                            );
 
+/* fixed timestep */
+void    spxeTimestep(       const double step,      const int   maxsteps    );
+int     spxeUpdate(         void                                            );
+double  spxeAlpha(          void                                            );
+int     spxeLoop(           const Px*   pixbuf,
+                            int       (*update)(void* data, double step),
+                            void      (*draw)(void* data, double alpha),
+                            void*       data                                );
+
 /* keyboard input */
 int     spxeKeyDown(        const int   key                                 );
 int     spxeKeyPressed(     const int   key                                 );
@@ -114,6 +163,154 @@ int     spxeMousePressed(   const int   button                              );
 int     spxeMouseReleased(  const int   button                              );
 void    spxeMouseVisible(   const int   visible                             );
 
+/* separable filters, dst and src may be the same buffer */
+void    spxeBoxBlur(        Px*         dst,        const Px*   src,
+                            const int   width,      const int   height,
+                            const int   stride,     const int   radius      );
+void    spxeGaussianBlur(   Px*         dst,        const Px*   src,
+                            const int   width,      const int   height,
+                            const int   stride,     const float sigma       );
+void    spxeConvolve(       Px*         dst,        const Px*   src,
+                            const int   width,      const int   height,
+                            const int   stride,     const float* kernel,
+                            const int   radius                              );
+
+/* particles, kept as separate arrays and moved and drawn by worker threads */
+typedef struct spxeParticles {
+    float*      x;
+    float*      y;
+    float*      vx;
+    float*      vy;
+    float*      life;
+    Px*         color;
+    int         count;
+    int         capacity;
+} spxeParticles;
+
+spxeParticles* spxeParticlesCreate(const int capacity                       );
+int     spxeParticlesEmit(  spxeParticles* particles,
+                            const float x,          const float y,
+                            const float vx,         const float vy,
+                            const Px    color,      const float life        );
+void    spxeParticlesUpdate(spxeParticles* particles,
+                            const float dt,
+                            const float gx,         const float gy          );
+void    spxeParticlesDraw(  const spxeParticles* particles,
+                            Px*         pixbuf,
+                            const int   width,      const int   height,
+                            const int   stride,     const int   additive    );
+void    spxeParticlesFree(  spxeParticles* particles                        );
+
+/* triangle rasterizer, vertices in pixels with depth between 0 and 1 */
+typedef struct spxeVertex {
+    float       x;
+    float       y;
+    float       z;
+    Px          color;
+} spxeVertex;
+
+void    spxeTriangles(      Px*         pixbuf,     void*       depth,
+                            const int   depthbits,
+                            const int   width,      const int   height,
+                            const int   stride,
+                            const spxeVertex* vertices, const int count     );
+
+/* procedural generation, values depend only on the seed and counter or position */
+unsigned int spxeRandom(    const unsigned int seed, const unsigned int counter);
+void    spxeRandomFill(     unsigned int* out,      const int   count,
+                            const unsigned int seed, const unsigned int counter);
+float   spxeNoise(          const float x,          const float y,
+                            const unsigned int seed, const int  type        );
+void    spxeNoiseFill(      float*      out,
+                            const int   width,      const int   height,
+                            const int   stride,
+                            const float x,          const float y,
+                            const float scale,      const int   octaves,
+                            const unsigned int seed, const int  type        );
+void    spxeNoisePixels(    Px*         pixbuf,
+                            const int   width,      const int   height,
+                            const int   stride,
+                            const float x,          const float y,
+                            const float scale,      const int   octaves,
+                            const unsigned int seed, const int  type,
+                            const Px    from,       const Px    to          );
+
+/* affine blit, matrix maps src pixel coordinates to pixbuf ones */
+void    spxeBlitAffine(     Px*         pixbuf,
+                            const int   width,      const int   height,
+                            const int   stride,     const Px*   src,
+                            const int   srcwidth,   const int   srcheight,
+                            const int   srcstride,  const float* matrix,
+                            const int   filter                              );
+
+/* frame history, presented frames kept compressed for rewinding */
+int     spxeHistory(        const double seconds,   const unsigned long budget);
+void    spxeHistoryPause(   const int   pause                               );
+void    spxeHistoryDrop(    const int   count                               );
+int     spxeHistoryCount(   void                                            );
+unsigned long spxeHistoryDropped(void                                       );
+const Px* spxeHistoryFrame( const int   index,
+                            int*        widthptr,   int*        heightptr,
+                            double*     timeptr                             );
+
+/* image loading */
+typedef struct spxeImage spxeImage;
+
+Px*     spxeImageLoad(      const char* path,
+                            int*        widthptr,   int*        heightptr   );
+int     spxeImageRead(      const char* path,       Px*         pixbuf,
+                            const int   width,      const int   height,
+                            const int   stride                              );
+spxeImage* spxeImageOpen(   const char* path                                );
+int     spxeImageSize(      spxeImage*  image,
+                            int*        widthptr,   int*        heightptr   );
+int     spxeImageNext(      spxeImage*  image,      Px*         pixbuf,
+                            const int   width,      const int   height,
+                            const int   stride                              );
+void    spxeImageClose(     spxeImage*  image                               );
+
+/* shared memory frames */
+typedef struct spxeShared spxeShared;
+
+spxeShared* spxeSharedCreate(const char* name,
+                            const int   width,      const int   height,
+                            const int   count                               );
+Px*     spxeSharedBuffer(   spxeShared* shared                              );
+unsigned long spxeSharedPublish(spxeShared* shared                          );
+spxeShared* spxeSharedOpen( const char* name                                );
+int     spxeSharedSize(     spxeShared* shared,
+                            int*        widthptr,   int*        heightptr   );
+const Px* spxeSharedFrame(  spxeShared* shared,     unsigned long* seqptr   );
+int     spxeSharedValid(    spxeShared* shared,     unsigned long seq       );
+int     spxeSharedCopy(     spxeShared* shared,     Px*         pixbuf,
+                            unsigned long* seqptr                           );
+void    spxeSharedClose(    spxeShared* shared                              );
+
+/* frame streams over Unix or TCP sockets, changed tiles only */
+typedef struct spxeStream spxeStream;
+
+spxeStream* spxeStreamCreate(const char* address,
+                            const int   width,      const int   height      );
+unsigned long spxeStreamPublish(spxeStream* stream, const Px*   pixbuf,
+                            const int   stride                              );
+spxeStream* spxeStreamOpen( const char* address                             );
+int     spxeStreamSize(     spxeStream* stream,
+                            int*        widthptr,   int*        heightptr   );
+const Px* spxeStreamFrame(  spxeStream* stream,     unsigned long* seqptr   );
+void    spxeStreamClose(    spxeStream* stream                              );
+
+/* tracing, recorded only when built with SPXE_TRACE */
+void    spxeTraceBegin(     const char* name                                );
+void    spxeTraceEnd(       void                                            );
+int     spxeTraceDump(      const char* path                                );
+
+#ifdef SPXE_TRACE
+    #define SPXE_TRACE_BEGIN(name) spxeTraceBegin(name)
+    #define SPXE_TRACE_END() spxeTraceEnd()
+#else
+    #define SPXE_TRACE_BEGIN(name)
+    #define SPXE_TRACE_END()
+#endif
 
 /* macro keyboard and mouse input values */
 
@@ -251,6 +448,57 @@ void    spxeMouseVisible(   const int   visible                             );
 #define MOUSE_RIGHT         MOUSE_2
 #define MOUSE_MIDDLE        MOUSE_3
 
+/* macro framebuffer hint values */
+
+#define SPXE_ALIGNMENT      1
+#define SPXE_ROW_PADDING    2
+#define SPXE_HUGE_PAGES     3
+#define SPXE_FORMAT         4
+#define SPXE_DIRTY_PAGES    5
+#define SPXE_THREADS        6
+#define SPXE_PAGE           -1
+#define SPXE_AUTO           -1
+
+/* macro framebuffer formats and tone mapping operators */
+
+#define SPXE_RGBA8          0
+#define SPXE_RGBA16F        1
+#define SPXE_RGBA32F        2
+#define SPXE_CLAMP          0
+#define SPXE_REINHARD       1
+#define SPXE_ACES           2
+
+/* macro pixel program layers */
+
+#define SPXE_UNDER          0
+#define SPXE_OVER           1
+#define SPXE_PROGRAMS       8
+#define SPXE_PARAMS         16
+
+/* macro managed framebuffers */
+
+#define SPXE_BUFFERS        8
+
+/* macro idle mode, renders per frame compared and hash lanes */
+
+#define SPXE_IDLE_RENDERS   4
+#define SPXE_IDLE_LANES     8
+
+/* macro banded rendering, pixel buffer objects uploading at once */
+
+#define SPXE_BANDS          4
+
+/* macro procedural noise types */
+
+#define SPXE_NOISE_VALUE    0
+#define SPXE_NOISE_PERLIN   1
+#define SPXE_NOISE_SIMPLEX  2
+
+/* macro affine blit filters */
+
+#define SPXE_NEAREST        0
+#define SPXE_BILINEAR       1
+
 /******************
 ****** spxe *******
 Simple PiXel Engine
@@ -258,12 +506,64 @@ Simple PiXel Engine
 * IMPLEMENTATION  *
 ******************/
 
-#ifdef SPXE_APPLICATION
+#if defined(SPXE_APPLICATION) || defined(SPXE_PRODUCER)
+
+#if !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__))
+    #ifndef _DEFAULT_SOURCE
+        #define _DEFAULT_SOURCE
+    #endif
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif
+    /* the feature macro does nothing when a libc header was included before
+    spxe.h in a strict C build, only the portable code is used then */
+    #if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L && defined(MAP_ANONYMOUS)
+        #define SPXE_POSIX
+    #endif
+#endif
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#ifdef SPXE_POSIX
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define SPXE_BARRIER() __sync_synchronize()
+#else
+    #define SPXE_BARRIER()
+#endif
+
+#endif /* SPXE_APPLICATION || SPXE_PRODUCER */
+
+#ifdef SPXE_APPLICATION
+
+#if defined(SPXE_X11) && !defined(SPXE_POSIX)
+    #error "SPXE_X11 needs POSIX, include spxe.h before other headers or define _DEFAULT_SOURCE"
+#endif
+
+#ifdef SPXE_X11
+    #include <time.h>
+    #include <sys/ipc.h>
+    #include <sys/shm.h>
+    #include <sys/select.h>
+    #include <X11/Xlib.h>
+    #include <X11/Xutil.h>
+    #include <X11/XKBlib.h>
+    #include <X11/keysym.h>
+    #include <X11/extensions/XShm.h>
+    /* glfw input values used by the shared input code */
+    #define GLFW_RELEASE 0
+    #define GLFW_PRESS 1
+    #define GLFW_MOD_SHIFT 0x0001
+    #define GLFW_MOD_CAPS_LOCK 0x0010
+#else
+
 #ifndef __APPLE__
     #include <GL/glew.h>
     #define GLFW_MOD_CAPS_LOCK 0x0010
@@ -301,21 +601,78 @@ Simple PiXel Engine
 "    gl_Position = vec4(vertCoord.xy,0.,1.); \n"\
 "}\n"
 
+/* tone = (exposure, operator, srgb), the identity for 8 bit framebuffers */
 #define SPXE_SHADER_FRAGMENT                    \
 "in vec2 TexCoords;\n"                          \
 "out vec4 FragColor;\n"                         \
 "uniform sampler2D tex;\n"                      \
+"uniform vec3 tone;\n"                          \
 "void main(void) {\n"                           \
-"    FragColor = texture(tex, TexCoords);\n"    \
+"    vec4 c = texture(tex, TexCoords);\n"       \
+"    vec3 x = max(c.rgb * tone.x, 0.);\n"       \
+"    if (tone.y == 1.) x /= 1. + x;\n"          \
+"    if (tone.y == 2.) x = x*(2.51*x+.03) / (x*(2.43*x+.59)+.14);\n"\
+"    x = clamp(x, 0., 1.);\n"                   \
+"    if (tone.z > 0.) x = mix(x*12.92, 1.055*pow(x, vec3(.41667))-.055, step(.0031308, x));\n"\
+"    FragColor = vec4(x, clamp(c.a, 0., 1.));\n"\
 "}\n"
 
+/* declarations available to pixel programs, followed by the user source */
+#define SPXE_SHADER_PROGRAM                     \
+"in vec2 TexCoords;\n"                          \
+"out vec4 FragColor;\n"                         \
+"uniform sampler2D tex;\n"                      \
+"uniform float time;\n"                         \
+"uniform vec2 resolution;\n"                    \
+"uniform vec4 params[" SPXE_TOK2STR(SPXE_PARAMS) " / 4];\n"
+
 static const char* vertexShader = SPXE_SHADER_HEADER SPXE_SHADER_VERTEX;
 static const char* fragmentShader = SPXE_SHADER_HEADER SPXE_SHADER_FRAGMENT;
 
+#endif /* SPXE_X11 */
+
 /* spxe core handler */
 
+#ifdef SPXE_X11
+
+#define SPXE_WINDOW struct spxeX11
+
+static struct spxeX11 {
+    Display* display;
+    Window window;
+    GC gc;
+    Atom close;
+    Cursor hidden;
+    XImage* image;
+    XShmSegmentInfo shminfo;
+    int shm;
+    int closed;
+    int mousex;
+    int mousey;
+    int buttons[MOUSE_LAST + 1];
+    int* columns;
+    int shifts[3];
+    unsigned int background;
+    double start;
+    double last;
+} spxex;
+
+#else
+    #define SPXE_WINDOW GLFWwindow
+#endif
+
+/* full screen pixel program drawn under or over the pixel buffer */
+struct spxeLayer {
+    unsigned int program;
+    int layer;
+    int time;
+    int resolution;
+    int params;
+    float values[SPXE_PARAMS];
+};
+
 static struct spxeInfo {
-    GLFWwindow* window;
+    SPXE_WINDOW* window;
     struct spxeRes {
         int width;
         int height;
@@ -331,10 +688,116 @@ static struct spxeInfo {
         unsigned char keys[KEY_LAST];
         unsigned char pressedKeys[KEY_LAST];
     } input;
-} spxe = {NULL, {400, 300}, {800, 600}, {1.0, 1.0}, {GLFW_RELEASE, 1, 0, {0}, {0}}};
+    struct spxeClock {
+        double step;
+        double last;
+        double accum;
+        int maxsteps;
+        int steps;
+        int frame;
+    } clock;
+    struct spxeHints {
+        int alignment;
+        int padding;
+        int hugepages;
+        int format;
+        int dirty;
+        int threads;
+    } hints;
+    int stride;
+    struct spxeDynamic {
+        double budget;
+        double average;
+        double mark;
+        struct spxeRes full, min, target;
+        int cooldown;
+        int measured;
+    } dynamic;
+    struct spxeTone {
+        float exposure;
+        int tonemap;
+        int srgb;
+        int uniform;
+    } tone;
+    struct spxeLayers {
+        unsigned int shader;
+        int count;
+        int under;
+        struct spxeLayer programs[SPXE_PROGRAMS];
+    } layers;
+    struct spxeBuffers {
+        int count;
+        int current;
+        Px* list[SPXE_BUFFERS];
+    } buffers;
+    struct spxeIdle {
+        double timeout;
+        int hash;
+        int redraw;
+        int drawn;
+        int renders;
+        int previous;
+        const Px* pending[SPXE_IDLE_RENDERS];
+        unsigned int hashes[SPXE_IDLE_RENDERS][SPXE_IDLE_LANES];
+    } idle;
+    struct spxeCanvas {
+        Px* data;
+        size_t size;
+        int width;
+        int height;
+        int x;
+        int y;
+    } canvas;
+    struct spxeBands {
+        unsigned int buffers[SPXE_BANDS];
+        int current;
+        int uploaded;
+    } bands;
+} spxe = {
+    NULL, {400, 300}, {800, 600}, {1.0, 1.0}, {GLFW_RELEASE, 1, 0, {0}, {0}},
+    {1.0 / 60.0, -1.0, 0.0, 8, 0, 1}, {0, 0, 0, SPXE_RGBA8, 0, 0}, 400,
+    {0.0, 0.0, -1.0, {0, 0}, {0, 0}, {0, 0}, 0, 0}, {1.0F, SPXE_CLAMP, 0, -1},
+    {0, 0, 0, {{0, 0, 0, 0, 0, {0}}}}, {0, 0, {0}}, {0.0, 0, 1, 0, 0, 0, {0}, {{0}}},
+    {NULL, 0, 0, 0, 0, 0}, {{0}, 0, 0}
+};
+
+/* size in bytes of a framebuffer pixel */
+static int spxePixelSize(void)
+{
+    static const int sizes[] = {4, 8, 16};
+    return sizes[spxe.hints.format];
+}
 
 /* implementation only static functions */
 
+/* viewport origin kept inside the canvas, also when the screen is resized */
+static void spxeViewportClamp(int* x, int* y)
+{
+    *x = spxe.canvas.x < spxe.canvas.width - spxe.scrres.width ?
+        spxe.canvas.x : spxe.canvas.width - spxe.scrres.width;
+    *y = spxe.canvas.y < spxe.canvas.height - spxe.scrres.height ?
+        spxe.canvas.y : spxe.canvas.height - spxe.scrres.height;
+    *x = *x > 0 ? *x : 0;
+    *y = *y > 0 ? *y : 0;
+}
+
+/* first visible pixel and row stride of a buffer, the viewport of the canvas */
+static const Px* spxeSource(const Px* pixbuf, int* stride)
+{
+    int x, y;
+    if (!spxe.canvas.data || pixbuf != spxe.canvas.data) {
+        *stride = spxe.stride;
+        return pixbuf;
+    }
+
+    spxeViewportClamp(&x, &y);
+    *stride = spxe.canvas.width;
+    return (const Px*)(
+        (const unsigned char*)pixbuf +
+        ((size_t)y * spxe.canvas.width + x) * spxePixelSize()
+    );
+}
+
 static void spxeFrame(void)
 {
     int i;
@@ -346,24 +809,34 @@ static void spxeFrame(void)
         -1.0f,  1.0f,   0.0f,   1.0f
     };
 
-    const float w = (float)spxe.winres.width / (float)spxe.scrres.width;
-    const float h = (float)spxe.winres.height / (float)spxe.scrres.height;
+    /* keep the aspect of the full resolution while it is scaled dynamically */
+    const int dynamic = spxe.dynamic.budget > 0.0;
+    const int width = dynamic ? spxe.dynamic.full.width : spxe.scrres.width;
+    const int height = dynamic ? spxe.dynamic.full.height : spxe.scrres.height;
+    const float w = (float)spxe.winres.width / (float)width;
+    const float h = (float)spxe.winres.height / (float)height;
     
     spxe.ratio.width = (h < w) ? (h / w) : 1.0f;
     spxe.ratio.height = (w < h) ? (w / h) : 1.0f;
 
+#ifndef SPXE_X11
     for (i = 0; i < 16; i += 4) {
         vertices[i] *= spxe.ratio.width;
         vertices[i + 1] *= spxe.ratio.height;
     }
     
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+#else
+    (void)i;
+    (void)vertices;
+#endif
 }
 
-static void spxeKeyboard(GLFWwindow* win, int key, int code, int action, int mod)
+static void spxeKey(const int key, const int action, const int mod)
 {
-    (void)win;
-    (void)code;
+    if (key < 0 || key >= KEY_LAST) {
+        return;
+    }
 
     if (key < 128 && !spxe.input.keys[key]) {
         if (mod == GLFW_MOD_CAPS_LOCK || mod == GLFW_MOD_SHIFT || key < 65) {
@@ -375,133 +848,287 @@ static void spxeKeyboard(GLFWwindow* win, int key, int code, int action, int mod
 
     spxe.input.keys[key] = action;
     spxe.input.pressedKeys[key] = spxe.input.pressedKeys[key] * (action != 0);
+    spxe.idle.redraw = 1;
 }
 
-static void spxeWindow(GLFWwindow* window, int width, int height)
+/* dirty page tracking, pages of the pixel buffer are write protected after
+every upload and the first write to each one is caught in a signal handler */
+
+#if defined(SPXE_POSIX) && !defined(SPXE_X11)
+
+#define SPXE_DIRTY
+#include <signal.h>
+
+static struct spxeDirty {
+    unsigned char* base;
+    unsigned char* pages;
+    size_t size;
+    size_t page;
+    volatile int touched;
+    int uploaded;
+    struct sigaction segv, bus;
+} spxed;
+
+static void spxeDirtyFault(int sig, siginfo_t* info, void* context)
 {
-    (void)window;
-#ifndef __APPLE__
-    glViewport(0, 0, width, height);
-#endif
-    spxe.winres.width = width;
-    spxe.winres.height = height;
-    spxeFrame();
-}
+    const struct sigaction* previous = sig == SIGSEGV ? &spxed.segv : &spxed.bus;
+    unsigned char* addr = (unsigned char*)info->si_addr;
+    if (spxed.pages && addr >= spxed.base && addr < spxed.base + spxed.size) {
+        const size_t page = (size_t)(addr - spxed.base) / spxed.page;
+        spxed.pages[page] = 1;
+        spxed.touched = 1;
+        mprotect(spxed.base + page * spxed.page, spxed.page, PROT_READ | PROT_WRITE);
+        return;
+    }
 
-/* window and screen size getters */
+    /* not a tracked page, handled as if this handler wasn't installed */
+    if (previous->sa_flags & SA_SIGINFO) {
+        previous->sa_sigaction(sig, info, context);
+    }
+    else if (previous->sa_handler == SIG_DFL) {
+        sigaction(sig, previous, NULL);
+        raise(sig);
+    }
+    else if (previous->sa_handler != SIG_IGN) {
+        previous->sa_handler(sig);
+    }
+}
 
-void spxeWindowSize(int* width, int* height)
+static void spxeDirtyTrack(unsigned char* base, const size_t size, const size_t page)
 {
-    *width = spxe.winres.width;
-    *height = spxe.winres.height;
+    if (spxed.pages) {
+        sigaction(SIGSEGV, &spxed.segv, NULL);
+        sigaction(SIGBUS, &spxed.bus, NULL);
+        free(spxed.pages);
+        spxed.pages = NULL;
+        spxed.base = NULL;
+    }
+
+    if (base) {
+        struct sigaction sa;
+        spxed.page = page;
+        spxed.size = (size + page - 1) / page * page;
+        spxed.pages = (unsigned char*)calloc(spxed.size / page, 1);
+        if (!spxed.pages) {
+            fprintf(stderr, "spxe failed to allocate dirty page tracking.\n");
+            return;
+        }
+
+        memset(&sa, 0, sizeof(sa));
+        sigemptyset(&sa.sa_mask);
+        sa.sa_sigaction = spxeDirtyFault;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigaction(SIGSEGV, &sa, &spxed.segv);
+        sigaction(SIGBUS, &sa, &spxed.bus);
+        spxed.base = base;
+        spxed.uploaded = 0;
+    }
 }
 
-void spxeScreenSize(int* width, int* height)
+static int spxeDirtyPartial(const Px* pixbuf)
 {
-    *width = spxe.scrres.width;
-    *height = spxe.scrres.height;
+    return spxed.base && spxed.uploaded && (const unsigned char*)pixbuf == spxed.base;
 }
 
-/* time input */
+/* next range of rows covered by consecutive dirty pages, page is the cursor */
+static int spxeDirtySpan(size_t* page, int* y, int* rows)
+{
+    const size_t count = spxed.size / spxed.page;
+    const size_t row = (size_t)spxe.stride * spxePixelSize();
+    while (*page < count) {
+        size_t first, last;
+        while (*page < count && !spxed.pages[*page]) {
+            ++*page;
+        }
 
-double spxeTime(void)
+        first = *page;
+        while (*page < count && spxed.pages[*page]) {
+            ++*page;
+        }
+
+        last = (*page * spxed.page + row - 1) / row;
+        last = last > (size_t)spxe.scrres.height ? (size_t)spxe.scrres.height : last;
+        *y = (int)(first * spxed.page / row);
+        *rows = (int)last - *y;
+        if (first < count && *rows > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void spxeDirtyReset(const Px* pixbuf)
 {
-    return glfwGetTime();
+    if (!spxed.base) {
+        return;
+    }
+
+    if ((const unsigned char*)pixbuf != spxed.base) {
+        spxed.uploaded = 0;
+        return;
+    }
+
+    if (spxed.touched || !spxed.uploaded) {
+        memset(spxed.pages, 0, spxed.size / spxed.page);
+        spxed.touched = 0;
+        mprotect(spxed.base, spxed.size, PROT_READ);
+    }
+    spxed.uploaded = 1;
 }
 
-/* keyboard input */
+#elif !defined(SPXE_X11)
 
-int spxeKeyDown(const int key)
+static int spxeDirtyPartial(const Px* pixbuf)
 {
-    return !!spxe.input.keys[key];
+    (void)pixbuf;
+    return 0;
 }
 
-int spxeKeyPressed(const int key)
+static int spxeDirtySpan(size_t* page, int* y, int* rows)
 {
-    if (!spxe.input.pressedKeys[key] && spxe.input.keys[key]) {
-        spxe.input.pressedKeys[key] = 1;
-        return 1;
-    }
+    (void)page;
+    (void)y;
+    (void)rows;
     return 0;
 }
 
-int spxeKeyReleased(const int key)
+static void spxeDirtyReset(const Px* pixbuf)
 {
-    if (!spxe.input.keys[key] && spxe.input.pressedKeys[key]) {
-        spxe.input.pressedKeys[key] = 0;
-        return 1;
-    }
-    return 0;
+    (void)pixbuf;
 }
 
-char spxeKeyChar(void)
+#endif /* SPXE_DIRTY */
+
+#ifndef SPXE_X11
+
+/* OpenGL backend */
+
+static const GLint spxeInternalFormats[] = {GL_RGBA, GL_RGBA16F, GL_RGBA32F};
+static const GLenum spxeTypes[] = {GL_UNSIGNED_BYTE, GL_HALF_FLOAT, GL_FLOAT};
+
+static unsigned int spxeShader(const char** sources, const int count)
 {
-    char ch = 0;
-    if (spxe.input.queuedChar) {
-        ch = spxe.input.memChar;
-        spxe.input.queuedChar = 0;
+    int ok;
+    char log[1024];
+    unsigned int shader, vshader, fshader;
+
+    shader = glCreateProgram();
+
+    vshader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vshader, 1, &vertexShader, NULL);
+    glCompileShader(vshader);
+
+    fshader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fshader, count, sources, NULL);
+    glCompileShader(fshader);
+    glGetShaderiv(fshader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        glGetShaderInfoLog(fshader, sizeof(log), NULL, log);
+        fprintf(stderr, "spxe failed to compile fragment shader:\n%s\n", log);
     }
-    return ch;
-}
 
-/* mouse input */
+    glAttachShader(shader, vshader);
+    glAttachShader(shader, fshader);
+    glLinkProgram(shader);
 
-void spxeMousePos(int* x, int* y)
+    glDeleteShader(vshader);
+    glDeleteShader(fshader);
+
+    glGetProgramiv(shader, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        glDeleteProgram(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/* full screen pixel programs of one layer, drawn with the spxe quad */
+static void spxeLayerDraw(const int layer)
 {
-    double dx, dy;
-    float width, height, hwidth, hheight;
-    
-    glfwGetCursorPos(spxe.window, &dx, &dy);
-    width = (float)spxe.scrres.width;
-    height = (float)spxe.scrres.height;
-    hwidth = width * 0.5;
-    hheight = height * 0.5;
+    int i;
+    for (i = 0; i < spxe.layers.count; ++i) {
+        const struct spxeLayer* program = spxe.layers.programs + i;
+        if (program->layer != layer) {
+            continue;
+        }
 
-    dx = dx * (width / (float)spxe.winres.width);
-    dy = height - dy * (height / (float)spxe.winres.height);
-    *x = (int)((dx - hwidth) / spxe.ratio.width + hwidth);
-    *y = (int)((dy - hheight) / spxe.ratio.height + hheight);
+        SPXE_TRACE_BEGIN("program");
+        glUseProgram(program->program);
+        glUniform1f(program->time, (float)glfwGetTime());
+        glUniform2f(program->resolution, (float)spxe.scrres.width, (float)spxe.scrres.height);
+        glUniform4fv(program->params, SPXE_PARAMS / 4, program->values);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        SPXE_TRACE_END();
+    }
+
+    if (spxe.layers.count) {
+        glUseProgram(spxe.layers.shader);
+    }
 }
 
-int spxeMouseDown(const int button)
+static int spxeLayerCompile(const char* source)
 {
-    return glfwGetMouseButton(spxe.window, button);
+    const char* sources[3];
+    sources[0] = SPXE_SHADER_HEADER;
+    sources[1] = SPXE_SHADER_PROGRAM;
+    sources[2] = source;
+    return (int)spxeShader(sources, 3);
 }
 
-int spxeMousePressed(const int button)
+static void spxeTone(void)
 {
-    const int mouseButton = glfwGetMouseButton(spxe.window, button);
-    const int pressed = (mouseButton == GLFW_PRESS) && 
-                        (spxe.input.mouseState == GLFW_RELEASE);
-    spxe.input.mouseState = mouseButton;
-    return pressed;
+    if (spxe.tone.uniform != -1) {
+        glUniform3f(
+            spxe.tone.uniform, spxe.tone.exposure,
+            (float)spxe.tone.tonemap, (float)spxe.tone.srgb
+        );
+    }
 }
 
-int spxeMouseReleased(const int button)
+static void spxeKeyboard(GLFWwindow* win, int key, int code, int action, int mod)
 {
-    return !glfwGetMouseButton(spxe.window, button);
+    (void)win;
+    (void)code;
+    SPXE_TRACE_BEGIN("key");
+    spxeKey(key, action, mod);
+    SPXE_TRACE_END();
 }
 
-void spxeMouseVisible(const int visible)
+static void spxeWindow(GLFWwindow* window, int width, int height)
 {
-    glfwSetInputMode(
-        spxe.window, GLFW_CURSOR, 
-        !visible ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL
-    );
+    (void)window;
+    SPXE_TRACE_BEGIN("resize");
+#ifndef __APPLE__
+    glViewport(0, 0, width, height);
+#endif
+    spxe.winres.width = width;
+    spxe.winres.height = height;
+    spxe.idle.redraw = 1;
+    spxeFrame();
+    SPXE_TRACE_END();
 }
 
-/* spxe core */
+static void spxeMouseButton(GLFWwindow* window, int button, int action, int mod)
+{
+    (void)window;
+    (void)button;
+    (void)action;
+    (void)mod;
+    spxe.idle.redraw = 1;
+}
 
-Px* spxeStart(          
-    const char* title,  const int winwidth, const int winheight, 
-    const int scrwidth, const int scrheight)
+static void spxeRefresh(GLFWwindow* window)
+{
+    (void)window;
+    spxe.idle.redraw = 1;
+}
+
+static int spxeOpen(const char* title)
 {
-    Px* pixbuf;
     GLFWwindow* window;
     unsigned int id, vao, ebo, texture;
-    unsigned int shader, vshader, fshader;
+    unsigned int shader;
 
-    const size_t scrsize = scrwidth * scrheight;
     const unsigned int indices[] = {
         0,  1,  3,
         1,  2,  3 
@@ -510,7 +1137,7 @@ Px* spxeStart(
     /* init glfw */
     if (!glfwInit()) {
         fprintf(stderr, "spxe failed to initiate glfw.\n");
-        return NULL;
+        return 0;
     }
 
     /* open and setup window */
@@ -525,19 +1152,24 @@ Px* spxeStart(
     glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
 #endif
 
-    window = glfwCreateWindow(winwidth, winheight, title, NULL, NULL);
+    window = glfwCreateWindow(spxe.winres.width, spxe.winres.height, title, NULL, NULL);
     if (!window) {
         fprintf(stderr, "spxe failed to open glfw window.\n");
         glfwTerminate();
-        return NULL;
+        return 0;
     }
     
+    spxe.window = window;
     glfwMakeContextCurrent(window);
     glfwSwapInterval(1);
 
-    glfwSetWindowSizeLimits(window, scrwidth, scrheight, GLFW_DONT_CARE, GLFW_DONT_CARE);
+    glfwSetWindowSizeLimits(
+        window, spxe.scrres.width, spxe.scrres.height, GLFW_DONT_CARE, GLFW_DONT_CARE
+    );
     glfwSetWindowSizeCallback(window, spxeWindow);
     glfwSetKeyCallback(window, spxeKeyboard);
+    glfwSetMouseButtonCallback(window, spxeMouseButton);
+    glfwSetWindowRefreshCallback(window, spxeRefresh);
     glfwSetInputMode(window, GLFW_MOD_CAPS_LOCK, GLFW_TRUE);
 
     /* OpenGL context and settings */
@@ -545,7 +1177,7 @@ Px* spxeStart(
     glewExperimental = GL_TRUE;
     if (glewInit() != GLEW_OK) {
         fprintf(stderr, "spxe failed to initiate glew.\n");
-        return NULL;
+        return 0;
     }
 #endif
 
@@ -554,39 +1186,17 @@ Px* spxeStart(
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDepthFunc(GL_LESS);
     
-    /* allocate pixel framebuffer */
-    pixbuf = (Px*)calloc(scrsize, sizeof(Px));
-    if (!pixbuf) {
-        fprintf(stderr, "spxe failed to allocate pixel framebuffer.\n");
-        return NULL;
+    /* compile and link shaders */
+    shader = spxeShader(&fragmentShader, 1);
+    if (!shader) {
+        fprintf(stderr, "spxe failed to link shader program.\n");
+        return 0;
     }
-
-    /* set global information */
-    spxe.window = window;
-    spxe.winres.width = winwidth;
-    spxe.winres.height = winheight;
-    spxe.scrres.width = scrwidth;
-    spxe.scrres.height = scrheight;
-    
-    /* compile and link shaders */
-    shader = glCreateProgram();
-    
-    vshader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vshader, 1, &vertexShader, NULL);
-    glCompileShader(vshader);
-
-    fshader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fshader, 1, &fragmentShader, NULL);
-    glCompileShader(fshader);
-
-    glAttachShader(shader, vshader);
-    glAttachShader(shader, fshader);
-    glLinkProgram(shader);
-    
-    glDeleteShader(vshader);
-    glDeleteShader(fshader);
-    
-    glUseProgram(shader);
+    
+    spxe.layers.shader = shader;
+    glUseProgram(shader);
+    spxe.tone.uniform = glGetUniformLocation(shader, "tone");
+    spxeTone();
 
     /* create vertex buffers */
     glGenVertexArrays(1, &id);
@@ -614,54 +1224,5336 @@ Px* spxeStart(
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     
     glTexImage2D(
-        GL_TEXTURE_2D, 0, GL_RGBA, spxe.scrres.width, spxe.scrres.height, 
-        0, GL_RGBA, GL_UNSIGNED_BYTE, pixbuf
+        GL_TEXTURE_2D, 0, spxeInternalFormats[spxe.hints.format],
+        spxe.scrres.width, spxe.scrres.height,
+        0, GL_RGBA, spxeTypes[spxe.hints.format], NULL
     );
 
-    return pixbuf;
+    return 1;
 }
 
-void spxeBackgroundColor(const Px c)
+/* texture quad over the programs under the pixel buffer */
+static void spxeDraw(void)
 {
-    const float n = 1.0F / 255.0F;
-    glClearColor((float)c.r * n, (float)c.g * n, (float)c.b * n, (float)c.a * n);
+    if (!spxe.layers.under) {
+        spxe.layers.under = 1;
+        spxeLayerDraw(SPXE_UNDER);
+    }
+
+    SPXE_TRACE_BEGIN("draw");
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    SPXE_TRACE_END();
 }
 
-void spxeRender(const Px* pixbuf)
+static void spxeUpload(const Px* pixbuf)
 {
-    glTexImage2D(
-        GL_TEXTURE_2D, 0, GL_RGBA, spxe.scrres.width, spxe.scrres.height, 
-        0, GL_RGBA, GL_UNSIGNED_BYTE, pixbuf
+    int stride;
+    SPXE_TRACE_BEGIN("upload");
+    pixbuf = spxeSource(pixbuf, &stride);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+    if (spxeDirtyPartial(pixbuf)) {
+        int y, rows;
+        size_t page = 0;
+        while (spxeDirtySpan(&page, &y, &rows)) {
+            glTexSubImage2D(
+                GL_TEXTURE_2D, 0, 0, y, spxe.scrres.width, rows, GL_RGBA,
+                spxeTypes[spxe.hints.format],
+                (const unsigned char*)pixbuf + (size_t)y * spxe.stride * spxePixelSize()
+            );
+        }
+    }
+    else glTexImage2D(
+        GL_TEXTURE_2D, 0, spxeInternalFormats[spxe.hints.format],
+        spxe.scrres.width, spxe.scrres.height,
+        0, GL_RGBA, spxeTypes[spxe.hints.format], pixbuf
     );
+    spxeDirtyReset(pixbuf);
+    SPXE_TRACE_END();
+    spxeDraw();
+}
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+/* rows copied into the next buffer object of the ring, the texture is updated from
+it by the driver in the background while the application computes the next band */
+static void spxeUploadBand(const Px* pixbuf, const int y, const int rows)
+{
+    int i, stride;
+    unsigned char* dst;
+    const unsigned char* src;
+    const size_t row = (size_t)spxe.scrres.width * spxePixelSize();
+    unsigned int* buffer = spxe.bands.buffers + spxe.bands.current;
+
+    SPXE_TRACE_BEGIN("band");
+    spxe.bands.current = (spxe.bands.current + 1) % SPXE_BANDS;
+    src = (const unsigned char*)spxeSource(pixbuf, &stride);
+    src += (size_t)y * stride * spxePixelSize();
+    if (!*buffer) {
+        glGenBuffers(1, buffer);
+    }
+
+    /* new storage is handed out if the previous upload from this buffer is still running */
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, *buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)(row * rows), NULL, GL_STREAM_DRAW);
+    dst = (unsigned char*)glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)(row * rows),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+    );
+
+    if (dst) {
+        for (i = 0; i < rows; ++i) {
+            memcpy(dst + row * i, src + (size_t)i * stride * spxePixelSize(), row);
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, spxe.scrres.width);
+        glTexSubImage2D(
+            GL_TEXTURE_2D, 0, 0, y, spxe.scrres.width, rows, GL_RGBA,
+            spxeTypes[spxe.hints.format], NULL
+        );
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+        glTexSubImage2D(
+            GL_TEXTURE_2D, 0, 0, y, spxe.scrres.width, rows, GL_RGBA,
+            spxeTypes[spxe.hints.format], src
+        );
+    }
+
+    /* starts the transfer now instead of at the next draw */
+    glFlush();
+    SPXE_TRACE_END();
 }
 
-int spxeStep(void)
-{ 
+/* the texture already holds every band, only the dirty page state is caught up */
+static void spxeUploadBands(const Px* pixbuf)
+{
+    int stride;
+    spxeDirtyReset(spxeSource(pixbuf, &stride));
+    spxeDraw();
+}
+
+static int spxePresent(void)
+{
+    if (!spxe.layers.under) {
+        spxeLayerDraw(SPXE_UNDER);
+    }
+    spxeLayerDraw(SPXE_OVER);
+    spxe.layers.under = 0;
+
+
+    SPXE_TRACE_BEGIN("poll");
     glfwPollEvents();
+    SPXE_TRACE_END();
+    SPXE_TRACE_BEGIN("swap");
     glfwSwapBuffers(spxe.window);
+    SPXE_TRACE_END();
+    SPXE_TRACE_BEGIN("clear");
     glClear(GL_COLOR_BUFFER_BIT);
+    SPXE_TRACE_END();
     return !glfwWindowShouldClose(spxe.window);
 }
 
-int spxeRun(const Px* pixbuf)
+/* blocks until an event arrives or the timeout expires, the last frame stays on screen */
+static int spxeWait(const double timeout)
 {
-    spxeRender(pixbuf);
-    return spxeStep();
+    SPXE_TRACE_BEGIN("wait");
+    glfwWaitEventsTimeout(timeout);
+    SPXE_TRACE_END();
+    return !glfwWindowShouldClose(spxe.window);
 }
 
-int spxeEnd(Px* pixbuf)
+static void spxeClose(void)
 {
     glfwTerminate();
-    if (pixbuf) {
-        free(pixbuf);
-        return EXIT_SUCCESS;
+    memset(spxe.bands.buffers, 0, sizeof(spxe.bands.buffers));
+    spxe.bands.current = 0;
+}
+
+static double spxeClock(void)
+{
+    return glfwGetTime();
+}
+
+static void spxeCursor(double* x, double* y)
+{
+    glfwGetCursorPos(spxe.window, x, y);
+}
+
+static int spxeButton(const int button)
+{
+    return glfwGetMouseButton(spxe.window, button);
+}
+
+#else
+
+/* X11 MIT-SHM backend */
+
+static int spxeX11Failed;
+
+static int spxeX11Error(Display* display, XErrorEvent* error)
+{
+    (void)display;
+    (void)error;
+    spxeX11Failed = 1;
+    return 0;
+}
+
+static double spxeX11Time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static unsigned int spxeX11Pixel(const Px px)
+{
+    return  ((unsigned int)px.r << spxex.shifts[0]) | 
+            ((unsigned int)px.g << spxex.shifts[1]) | 
+            ((unsigned int)px.b << spxex.shifts[2]);
+}
+
+static int spxeX11Shift(unsigned long mask)
+{
+    int shift = 0;
+    while (mask && !(mask & 1)) {
+        mask >>= 1;
+        ++shift;
+    }
+    return shift;
+}
+
+static void spxeX11Free(void)
+{
+    if (!spxex.image) {
+        return;
     }
 
-    return EXIT_FAILURE;
+    if (spxex.shm) {
+        XShmDetach(spxex.display, &spxex.shminfo);
+        XSync(spxex.display, False);
+        shmdt(spxex.shminfo.shmaddr);
+        spxex.image->data = NULL;
+    }
+
+    XDestroyImage(spxex.image);
+    spxex.image = NULL;
 }
 
-#endif /* SPXE_APPLICATION */
+/* pixels are written as 32 bit words, packed 24 bit images would overrun each row */
+static int spxeX11Bits(void)
+{
+    if (spxex.image && spxex.image->bits_per_pixel != 32) {
+        fprintf(stderr, "spxe requires 32 bits per pixel x11 images.\n");
+        spxex.image->data = NULL;
+        XDestroyImage(spxex.image);
+        spxex.image = NULL;
+        return 0;
+    }
+    return spxex.image != NULL;
+}
+
+static int spxeX11Image(void)
+{
+    const int width = spxe.winres.width, height = spxe.winres.height;
+    const int screen = DefaultScreen(spxex.display);
+    Visual* visual = DefaultVisual(spxex.display, screen);
+    const int depth = DefaultDepth(spxex.display, screen);
+    int* columns;
+
+    spxeX11Free();
+    columns = (int*)realloc(spxex.columns, width * sizeof(int));
+    if (!columns) {
+        return 0;
+    }
+    spxex.columns = columns;
+
+    if (spxex.shm) {
+        XErrorHandler handler;
+        spxex.image = XShmCreateImage(
+            spxex.display, visual, depth, ZPixmap, NULL, &spxex.shminfo, width, height
+        );
+        if (spxex.image && !spxeX11Bits()) {
+            return 0;
+        }
+        
+        spxex.shminfo.shmid = spxex.image ? shmget(
+            IPC_PRIVATE, (size_t)spxex.image->bytes_per_line * height, IPC_CREAT | 0600
+        ) : -1;
+        
+        spxex.shminfo.shmaddr = spxex.shminfo.shmid != -1 ? 
+            (char*)shmat(spxex.shminfo.shmid, NULL, 0) : (char*)-1;
+        
+        if (spxex.shminfo.shmaddr != (char*)-1) {
+            spxex.image->data = spxex.shminfo.shmaddr;
+            spxex.shminfo.readOnly = False;
+            
+            /* attaching fails asynchronously on remote displays */
+            spxeX11Failed = 0;
+            handler = XSetErrorHandler(spxeX11Error);
+            XShmAttach(spxex.display, &spxex.shminfo);
+            XSync(spxex.display, False);
+            XSetErrorHandler(handler);
+            
+            /* the segment is freed once both sides detach from it */
+            shmctl(spxex.shminfo.shmid, IPC_RMID, NULL);
+            if (!spxeX11Failed) {
+                return 1;
+            }
+            shmdt(spxex.shminfo.shmaddr);
+        }
+        else if (spxex.shminfo.shmid != -1) {
+            shmctl(spxex.shminfo.shmid, IPC_RMID, NULL);
+        }
+        
+        if (spxex.image) {
+            spxex.image->data = NULL;
+            XDestroyImage(spxex.image);
+            spxex.image = NULL;
+        }
+        spxex.shm = 0;
+    }
+
+    spxex.image = XCreateImage(
+        spxex.display, visual, depth, ZPixmap, 0, NULL, width, height, 32, 0
+    );
+    if (!spxeX11Bits()) {
+        return 0;
+    }
+    
+    spxex.image->data = (char*)malloc((size_t)spxex.image->bytes_per_line * height);
+    return spxex.image->data != NULL;
+}
+
+static void spxeX11Clear(void)
+{
+    int x, y;
+    for (y = 0; y < spxex.image->height; ++y) {
+        unsigned int* row = (unsigned int*)(spxex.image->data + (size_t)y * spxex.image->bytes_per_line);
+        for (x = 0; x < spxex.image->width; ++x) {
+            row[x] = spxex.background;
+        }
+    }
+}
+
+static int spxeX11Key(XKeyEvent* event)
+{
+    KeySym sym = XLookupKeysym(event, 1);
+    if (sym >= XK_KP_0 && sym <= XK_KP_9) {
+        return KEY_KP_0 + (int)(sym - XK_KP_0);
+    }
+    if (sym == XK_KP_Decimal) {
+        return KEY_KP_DECIMAL;
+    }
+
+    sym = XLookupKeysym(event, 0);
+    if (sym >= XK_a && sym <= XK_z) {
+        return KEY_A + (int)(sym - XK_a);
+    }
+    if (sym >= XK_space && sym <= XK_grave) {
+        return (int)sym;
+    }
+    if (sym >= XK_F1 && sym <= XK_F25) {
+        return KEY_F1 + (int)(sym - XK_F1);
+    }
+
+    switch (sym) {
+        case XK_Escape:         return KEY_ESCAPE;
+        case XK_Return:         return KEY_ENTER;
+        case XK_Tab:            return KEY_TAB;
+        case XK_BackSpace:      return KEY_BACKSPACE;
+        case XK_Insert:         return KEY_INSERT;
+        case XK_Delete:         return KEY_DELETE;
+        case XK_Right:          return KEY_RIGHT;
+        case XK_Left:           return KEY_LEFT;
+        case XK_Down:           return KEY_DOWN;
+        case XK_Up:             return KEY_UP;
+        case XK_Prior:          return KEY_PAGE_UP;
+        case XK_Next:           return KEY_PAGE_DOWN;
+        case XK_Home:           return KEY_HOME;
+        case XK_End:            return KEY_END;
+        case XK_Caps_Lock:      return KEY_CAPS_LOCK;
+        case XK_Scroll_Lock:    return KEY_SCROLL_LOCK;
+        case XK_Num_Lock:       return KEY_NUM_LOCK;
+        case XK_Print:          return KEY_PRINT_SCREEN;
+        case XK_Pause:          return KEY_PAUSE;
+        case XK_KP_Divide:      return KEY_KP_DIVIDE;
+        case XK_KP_Multiply:    return KEY_KP_MULTIPLY;
+        case XK_KP_Subtract:    return KEY_KP_SUBTRACT;
+        case XK_KP_Add:         return KEY_KP_ADD;
+        case XK_KP_Enter:       return KEY_KP_ENTER;
+        case XK_KP_Equal:       return KEY_KP_EQUAL;
+        case XK_Shift_L:        return KEY_LEFT_SHIFT;
+        case XK_Control_L:      return KEY_LEFT_CONTROL;
+        case XK_Alt_L:          return KEY_LEFT_ALT;
+        case XK_Super_L:        return KEY_LEFT_SUPER;
+        case XK_Shift_R:        return KEY_RIGHT_SHIFT;
+        case XK_Control_R:      return KEY_RIGHT_CONTROL;
+        case XK_Alt_R:          return KEY_RIGHT_ALT;
+        case XK_Super_R:        return KEY_RIGHT_SUPER;
+        case XK_Menu:           return KEY_MENU;
+    }
+
+    return -1;
+}
+
+static void spxeX11Events(void)
+{
+    XEvent event;
+    while (XPending(spxex.display)) {
+        XNextEvent(spxex.display, &event);
+        switch (event.type) {
+            case KeyPress:
+            case KeyRelease:
+                SPXE_TRACE_BEGIN("key");
+                spxeKey(
+                    spxeX11Key(&event.xkey), 
+                    event.type == KeyPress ? GLFW_PRESS : GLFW_RELEASE,
+                    ((event.xkey.state & ShiftMask) ? GLFW_MOD_SHIFT : 0) |
+                    ((event.xkey.state & LockMask) ? GLFW_MOD_CAPS_LOCK : 0)
+                );
+                SPXE_TRACE_END();
+                break;
+            case ButtonPress:
+            case ButtonRelease:
+                if (event.xbutton.button >= Button1 && event.xbutton.button <= Button3) {
+                    static const int buttons[] = {MOUSE_LEFT, MOUSE_MIDDLE, MOUSE_RIGHT};
+                    spxex.buttons[buttons[event.xbutton.button - Button1]] = 
+                        event.type == ButtonPress;
+                }
+                spxe.idle.redraw = 1;
+                spxex.mousex = event.xbutton.x;
+                spxex.mousey = event.xbutton.y;
+                break;
+            case MotionNotify:
+                spxex.mousex = event.xmotion.x;
+                spxex.mousey = event.xmotion.y;
+                break;
+            case ConfigureNotify:
+                if (event.xconfigure.width != spxe.winres.width ||
+                    event.xconfigure.height != spxe.winres.height) {
+                    int ok;
+                    SPXE_TRACE_BEGIN("resize");
+                    spxe.winres.width = event.xconfigure.width;
+                    spxe.winres.height = event.xconfigure.height;
+                    spxe.idle.redraw = 1;
+                    spxeFrame();
+                    ok = spxeX11Image();
+                    if (ok) {
+                        spxeX11Clear();
+                    }
+                    SPXE_TRACE_END();
+                    if (!ok) {
+                        fprintf(stderr, "spxe failed to resize x11 image.\n");
+                        spxex.closed = 1;
+                        return;
+                    }
+                }
+                break;
+            case Expose:
+                spxe.idle.redraw = 1;
+                break;
+            case ClientMessage:
+                if ((Atom)event.xclient.data.l[0] == spxex.close) {
+                    spxex.closed = 1;
+                }
+                break;
+        }
+    }
+}
+
+static int spxeOpen(const char* title)
+{
+    XGCValues values;
+    XSizeHints hints;
+    Visual* visual;
+    Pixmap pixmap;
+    XColor black;
+    int screen, major, minor;
+    Bool pixmaps;
+    static char empty[8] = {0};
+
+    if (spxe.hints.format != SPXE_RGBA8) {
+        fprintf(stderr, "spxe floating point framebuffers require OpenGL.\n");
+        return 0;
+    }
+
+    spxex.display = XOpenDisplay(NULL);
+    if (!spxex.display) {
+        fprintf(stderr, "spxe failed to open x11 display.\n");
+        return 0;
+    }
+
+    screen = DefaultScreen(spxex.display);
+    visual = DefaultVisual(spxex.display, screen);
+#if defined(__cplusplus) || defined(c_plusplus)
+    if (visual->c_class != TrueColor || DefaultDepth(spxex.display, screen) < 24) {
+#else
+    if (visual->class != TrueColor || DefaultDepth(spxex.display, screen) < 24) {
+#endif
+        fprintf(stderr, "spxe requires a 24 bit true color x11 visual.\n");
+        XCloseDisplay(spxex.display);
+        spxex.display = NULL;
+        return 0;
+    }
+
+    spxex.shifts[0] = spxeX11Shift(visual->red_mask);
+    spxex.shifts[1] = spxeX11Shift(visual->green_mask);
+    spxex.shifts[2] = spxeX11Shift(visual->blue_mask);
+    spxex.shm = XShmQueryVersion(spxex.display, &major, &minor, &pixmaps);
+
+    spxex.window = XCreateSimpleWindow(
+        spxex.display, RootWindow(spxex.display, screen), 0, 0, 
+        spxe.winres.width, spxe.winres.height, 0, 0, BlackPixel(spxex.display, screen)
+    );
+    
+    XStoreName(spxex.display, spxex.window, title);
+    XSelectInput(
+        spxex.display, spxex.window, KeyPressMask | KeyReleaseMask | ButtonPressMask |
+        ButtonReleaseMask | PointerMotionMask | StructureNotifyMask | ExposureMask
+    );
+
+    hints.flags = PMinSize;
+    hints.min_width = spxe.scrres.width;
+    hints.min_height = spxe.scrres.height;
+    XSetWMNormalHints(spxex.display, spxex.window, &hints);
+    
+    spxex.close = XInternAtom(spxex.display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(spxex.display, spxex.window, &spxex.close, 1);
+    XkbSetDetectableAutoRepeat(spxex.display, True, NULL);
+
+    memset(&values, 0, sizeof(values));
+    spxex.gc = XCreateGC(spxex.display, spxex.window, 0, &values);
+    
+    pixmap = XCreateBitmapFromData(spxex.display, spxex.window, empty, 8, 8);
+    memset(&black, 0, sizeof(black));
+    spxex.hidden = XCreatePixmapCursor(spxex.display, pixmap, pixmap, &black, &black, 0, 0);
+    XFreePixmap(spxex.display, pixmap);
+
+    spxe.window = &spxex;
+    spxeFrame();
+    if (!spxeX11Image()) {
+        fprintf(stderr, "spxe failed to create x11 image.\n");
+        XCloseDisplay(spxex.display);
+        spxex.display = NULL;
+        return 0;
+    }
+
+    spxeX11Clear();
+    XMapWindow(spxex.display, spxex.window);
+    XFlush(spxex.display);
+    spxex.start = spxex.last = spxeX11Time();
+    return 1;
+}
+
+/* nearest neighbor scaling of the screen rows [first, last) into the window, like GL_NEAREST */
+static void spxeX11Scale(const Px* pixbuf, const int first, const int last)
+{
+    int x, y, stride;
+    const int scrw = spxe.scrres.width, scrh = spxe.scrres.height;
+    const int winw = spxe.winres.width, winh = spxe.winres.height;
+    const int w = (int)((float)winw * spxe.ratio.width + 0.5F);
+    const int h = (int)((float)winh * spxe.ratio.height + 0.5F);
+    const int left = (winw - w) / 2, top = (winh - h) / 2;
+    if (!spxex.image) {
+        return;
+    }
+    
+    pixbuf = spxeSource(pixbuf, &stride);
+    for (x = 0; x < w; ++x) {
+        spxex.columns[x] = (int)(((2L * x + 1) * scrw) / (2L * w));
+    }
+
+    for (y = 0; y < h; ++y) {
+        const int row = scrh - 1 - (int)(((2L * y + 1) * scrh) / (2L * h));
+        const Px* src = pixbuf + (size_t)row * stride;
+        unsigned int* dst = (unsigned int*)(
+            spxex.image->data + (size_t)(top + y) * spxex.image->bytes_per_line
+        ) + left;
+        
+        if (row < first || row >= last) {
+            continue;
+        }
+        for (x = 0; x < w; ++x) {
+            const Px px = src[spxex.columns[x]];
+            if (px.a == 255) {
+                dst[x] = spxeX11Pixel(px);
+            }
+            else if (px.a) {
+                Px out;
+                const unsigned int a = px.a, n = 255 - px.a, d = dst[x];
+                out.r = (unsigned char)((px.r * a + ((d >> spxex.shifts[0]) & 0xff) * n) / 255);
+                out.g = (unsigned char)((px.g * a + ((d >> spxex.shifts[1]) & 0xff) * n) / 255);
+                out.b = (unsigned char)((px.b * a + ((d >> spxex.shifts[2]) & 0xff) * n) / 255);
+                dst[x] = spxeX11Pixel(out);
+            }
+        }
+    }
+}
+
+static void spxeUpload(const Px* pixbuf)
+{
+    SPXE_TRACE_BEGIN("upload");
+    spxeX11Scale(pixbuf, 0, spxe.scrres.height);
+    SPXE_TRACE_END();
+}
+
+/* bands are scaled into the image as they finish, there is no transfer to overlap */
+static void spxeUploadBand(const Px* pixbuf, const int y, const int rows)
+{
+    SPXE_TRACE_BEGIN("band");
+    spxeX11Scale(pixbuf, y, y + rows);
+    SPXE_TRACE_END();
+}
+
+static void spxeUploadBands(const Px* pixbuf)
+{
+    (void)pixbuf;
+}
+
+static int spxePresent(void)
+{
+    double t;
+    const double frame = 1.0 / 60.0;
+
+    SPXE_TRACE_BEGIN("swap");
+    if (!spxex.image) {
+        SPXE_TRACE_END();
+        return 0;
+    }
+    if (spxex.shm) {
+        XShmPutImage(
+            spxex.display, spxex.window, spxex.gc, spxex.image, 
+            0, 0, 0, 0, spxe.winres.width, spxe.winres.height, False
+        );
+    }
+    else XPutImage(
+        spxex.display, spxex.window, spxex.gc, spxex.image, 
+        0, 0, 0, 0, spxe.winres.width, spxe.winres.height
+    );
+
+    /* the server must be done reading the image before it is cleared */
+    XSync(spxex.display, False);
+    SPXE_TRACE_END();
+    SPXE_TRACE_BEGIN("poll");
+    spxeX11Events();
+    SPXE_TRACE_END();
+    if (spxex.closed) {
+        return 0;
+    }
+    
+    SPXE_TRACE_BEGIN("clear");
+    spxeX11Clear();
+    SPXE_TRACE_END();
+
+    /* there is no vsync without GL, pace presents at 60 hz instead */
+    t = spxeX11Time();
+    if (t - spxex.last < frame) {
+        struct timespec ts;
+        const double wait = frame - (t - spxex.last);
+        ts.tv_sec = (time_t)wait;
+        ts.tv_nsec = (long)((wait - (double)ts.tv_sec) * 1e9);
+        SPXE_TRACE_BEGIN("sleep");
+        nanosleep(&ts, NULL);
+        SPXE_TRACE_END();
+        t += wait;
+    }
+    spxex.last = t;
+    return 1;
+}
+
+/* blocks until an event arrives or the timeout expires, the last frame stays on screen */
+static int spxeWait(const double timeout)
+{
+    SPXE_TRACE_BEGIN("wait");
+    if (!XPending(spxex.display)) {
+        fd_set fds;
+        struct timeval tv;
+        const int fd = ConnectionNumber(spxex.display);
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+        tv.tv_sec = (long)timeout;
+        tv.tv_usec = (long)((timeout - (double)tv.tv_sec) * 1e6);
+        select(fd + 1, &fds, NULL, NULL, &tv);
+    }
+    spxeX11Events();
+    SPXE_TRACE_END();
+    spxex.last = spxeX11Time();
+    return !spxex.closed;
+}
+
+static void spxeClose(void)
+{
+    spxeX11Free();
+    free(spxex.columns);
+    spxex.columns = NULL;
+    if (!spxex.display) {
+        return;
+    }
+    XFreeCursor(spxex.display, spxex.hidden);
+    XFreeGC(spxex.display, spxex.gc);
+    XDestroyWindow(spxex.display, spxex.window);
+    XCloseDisplay(spxex.display);
+    spxex.display = NULL;
+}
+
+static double spxeClock(void)
+{
+    return spxeX11Time() - spxex.start;
+}
+
+static void spxeTone(void)
+{
+}
+
+static void spxeCursor(double* x, double* y)
+{
+    *x = (double)spxex.mousex;
+    *y = (double)spxex.mousey;
+}
+
+static int spxeButton(const int button)
+{
+    return button >= 0 && button <= MOUSE_LAST ? spxex.buttons[button] : 0;
+}
+
+#endif /* SPXE_X11 */
+
+/* pixel framebuffer allocation */
+
+struct spxeBlock {
+    void* base;
+    size_t size;
+    int mapped;
+};
+
+static size_t spxePageSize(void)
+{
+#ifdef SPXE_POSIX
+    const long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? (size_t)size : 4096;
+#else
+    return 4096;
+#endif
+}
+
+static size_t spxeAlignment(void)
+{
+    size_t align = sizeof(void*) * 2;
+    if (spxe.hints.alignment == SPXE_PAGE) {
+        return spxePageSize();
+    }
+    
+    while (align < (size_t)spxe.hints.alignment) {
+        align <<= 1;
+    }
+    return align;
+}
+
+static int spxeRowStride(const int width)
+{
+    int stride = width, padding = spxe.hints.padding, align = 0;
+    if (spxe.hints.alignment) {
+        align = spxe.hints.alignment == SPXE_PAGE ? 64 : (int)spxeAlignment();
+    }
+
+    /* rows a multiple of 4KB apart map to the same cache sets, skew them by a line */
+    if (padding == SPXE_AUTO) {
+        padding = (width * spxePixelSize()) % 4096 ? 0 : 64 / spxePixelSize();
+    }
+    stride += padding > 0 ? padding : 0;
+    
+    if (align > spxePixelSize()) {
+        const int n = align / spxePixelSize();
+        stride = (stride + n - 1) / n * n;
+    }
+    return stride;
+}
+
+static Px* spxeAlloc(const size_t size)
+{
+    size_t offset, align = spxeAlignment();
+    struct spxeBlock block;
+    
+    block.mapped = 0;
+#ifdef SPXE_POSIX
+    /* write protected pages can't be shared with the rest of the heap */
+    if (spxe.hints.hugepages || spxe.hints.dirty) {
+        const size_t page = spxePageSize();
+        align = align < page ? page : align;
+#ifdef MADV_HUGEPAGE
+        if (spxe.hints.hugepages) {
+            const size_t huge = 2 * 1024 * 1024;
+            align = align < huge ? huge : align;
+        }
+#endif
+        block.size = (size + page - 1) / page * page + align + sizeof(struct spxeBlock);
+        block.base = mmap(NULL, block.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        block.mapped = block.base != MAP_FAILED;
+    }
+#endif
+
+    if (!block.mapped) {
+        block.size = size + align + sizeof(struct spxeBlock);
+        block.base = calloc(block.size, 1);
+        if (!block.base) {
+            return NULL;
+        }
+    }
+
+    offset = ((size_t)block.base + sizeof(struct spxeBlock) + align - 1) & ~(align - 1);
+    memcpy((struct spxeBlock*)offset - 1, &block, sizeof(struct spxeBlock));
+
+#if defined(SPXE_POSIX) && defined(MADV_HUGEPAGE)
+    if (block.mapped && spxe.hints.hugepages) {
+        madvise((void*)offset, size, MADV_HUGEPAGE);
+    }
+#endif
+
+#ifdef SPXE_DIRTY
+    if (block.mapped && spxe.hints.dirty) {
+        spxeDirtyTrack((unsigned char*)offset, size, spxePageSize());
+    }
+#endif
+
+    return (Px*)offset;
+}
+
+static void spxeFree(Px* pixbuf)
+{
+    struct spxeBlock block;
+    memcpy(&block, (struct spxeBlock*)pixbuf - 1, sizeof(struct spxeBlock));
+#ifdef SPXE_DIRTY
+    if ((unsigned char*)pixbuf == spxed.base) {
+        spxeDirtyTrack(NULL, 0, 0);
+    }
+#endif
+#ifdef SPXE_POSIX
+    if (block.mapped) {
+        munmap(block.base, block.size);
+        return;
+    }
+#endif
+    free(block.base);
+}
+
+void spxeHint(const int hint, const int value)
+{
+    switch (hint) {
+        case SPXE_ALIGNMENT:
+            spxe.hints.alignment = value;
+            break;
+        case SPXE_ROW_PADDING:
+            spxe.hints.padding = value;
+            break;
+        case SPXE_HUGE_PAGES:
+            spxe.hints.hugepages = value;
+            break;
+        case SPXE_DIRTY_PAGES:
+            spxe.hints.dirty = value;
+            break;
+        case SPXE_THREADS:
+            spxe.hints.threads = value;
+            break;
+        case SPXE_FORMAT:
+            if (value >= SPXE_RGBA8 && value <= SPXE_RGBA32F) {
+                spxe.hints.format = value;
+            }
+            break;
+    }
+}
+
+int spxeStride(void)
+{
+    return spxe.stride;
+}
+
+/* managed framebuffers */
+
+/* only the buffer returned by spxeStart() keeps dirty page tracking */
+static Px* spxeAllocExtra(const size_t size)
+{
+    Px* buf;
+    const int dirty = spxe.hints.dirty;
+    spxe.hints.dirty = 0;
+    buf = spxeAlloc(size);
+    spxe.hints.dirty = dirty;
+    return buf;
+}
+
+int spxeBuffers(const int count)
+{
+    int i, n = spxe.buffers.count;
+    Px* list[SPXE_BUFFERS];
+    const size_t size = (size_t)spxe.stride * spxe.scrres.height * spxePixelSize();
+    if (!n || count < 1 || count > SPXE_BUFFERS) {
+        fprintf(stderr, "spxe failed to set %d framebuffers.\n", count);
+        return 0;
+    }
+
+    /* reorder from the current buffer so the one being drawn survives shrinking */
+    for (i = 0; i < n; ++i) {
+        list[i] = spxe.buffers.list[(spxe.buffers.current + i) % n];
+    }
+    for (i = n; i < count; ++i) {
+        list[i] = spxeAllocExtra(size);
+        if (!list[i]) {
+            fprintf(stderr, "spxe failed to allocate pixel framebuffer.\n");
+            while (i-- > n) {
+                spxeFree(list[i]);
+            }
+            return 0;
+        }
+    }
+    for (i = count; i < n; ++i) {
+        spxeFree(list[i]);
+    }
+
+    memcpy(spxe.buffers.list, list, count * sizeof(Px*));
+    spxe.buffers.count = count;
+    spxe.buffers.current = 0;
+    return count;
+}
+
+Px* spxeBuffer(const int index)
+{
+    const int n = spxe.buffers.count;
+    if (!n) {
+        return NULL;
+    }
+    return spxe.buffers.list[((spxe.buffers.current + index) % n + n) % n];
+}
+
+Px* spxeSwap(void)
+{
+    if (!spxe.buffers.count) {
+        return NULL;
+    }
+    spxe.buffers.current = (spxe.buffers.current + 1) % spxe.buffers.count;
+    return spxe.buffers.list[spxe.buffers.current];
+}
+
+/* virtual canvas */
+
+Px* spxeCanvas(const int width, const int height, const char* path)
+{
+    Px* data = NULL;
+    const size_t size = (size_t)width * height * spxePixelSize();
+    if (spxe.canvas.data) {
+        fprintf(stderr, "spxe failed to create canvas, there is one open already.\n");
+        return NULL;
+    }
+    if (width < spxe.scrres.width || height < spxe.scrres.height) {
+        fprintf(stderr, "spxe failed to create canvas, it is smaller than the screen.\n");
+        return NULL;
+    }
+
+#ifdef SPXE_POSIX
+    /* pages are only backed by memory or read from the file once they are touched */
+    if (path) {
+        struct stat st;
+        const int fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd == -1 || fstat(fd, &st) ||
+            ((size_t)st.st_size < size && ftruncate(fd, (off_t)size))) {
+            fprintf(stderr, "spxe failed to open canvas file: %s\n", path);
+            if (fd != -1) {
+                close(fd);
+            }
+            return NULL;
+        }
+        data = (Px*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+    else {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#endif
+        data = (Px*)mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    }
+    if ((void*)data == MAP_FAILED) {
+        fprintf(stderr, "spxe failed to map canvas of %dx%d pixels.\n", width, height);
+        return NULL;
+    }
+#else
+    if (path) {
+        fprintf(stderr, "spxe canvas files are only supported on Unix systems.\n");
+        return NULL;
+    }
+    data = spxeAllocExtra(size);
+    if (!data) {
+        fprintf(stderr, "spxe failed to allocate canvas.\n");
+        return NULL;
+    }
+#endif
+
+    spxe.canvas.data = data;
+    spxe.canvas.size = size;
+    spxe.canvas.width = width;
+    spxe.canvas.height = height;
+    spxe.canvas.x = 0;
+    spxe.canvas.y = 0;
+    spxe.idle.redraw = 1;
+    return data;
+}
+
+void spxeCanvasClose(Px* canvas)
+{
+    if (!canvas || canvas != spxe.canvas.data) {
+        return;
+    }
+
+#ifdef SPXE_POSIX
+    munmap(canvas, spxe.canvas.size);
+#else
+    spxeFree(canvas);
+#endif
+    spxe.canvas.data = NULL;
+    spxe.idle.redraw = 1;
+}
+
+void spxeViewport(const int x, const int y)
+{
+    spxe.canvas.x = x;
+    spxe.canvas.y = y;
+    spxeViewportClamp(&spxe.canvas.x, &spxe.canvas.y);
+    spxe.idle.redraw = 1;
+}
+
+void spxeViewportPos(int* x, int* y)
+{
+    *x = *y = 0;
+    if (spxe.canvas.data) {
+        spxeViewportClamp(x, y);
+    }
+}
+
+/* floating point framebuffers */
+
+void spxeToneMap(const float exposure, const int tonemap, const int srgb)
+{
+    spxe.tone.exposure = exposure;
+    spxe.tone.tonemap = tonemap;
+    spxe.tone.srgb = srgb;
+    spxe.idle.redraw = 1;
+    spxeTone();
+}
+
+/* round to nearest even, overflows to infinity and underflows to subnormals */
+unsigned short spxeHalf(const float f)
+{
+    unsigned int bits, sign, exp, mant;
+    memcpy(&bits, &f, sizeof(bits));
+    sign = (bits >> 16) & 0x8000;
+    exp = (bits >> 23) & 0xff;
+    mant = bits & 0x7fffff;
+
+    if (exp == 0xff) {
+        return (unsigned short)(sign | 0x7c00 | (mant ? 0x200 : 0));
+    }
+    if (exp > 142) {
+        return (unsigned short)(sign | 0x7c00);
+    }
+    if (exp < 113) {
+        unsigned int shift, half;
+        if (exp < 102) {
+            return (unsigned short)sign;
+        }
+        mant |= 0x800000;
+        shift = 126 - exp;
+        half = mant >> shift;
+        if ((mant >> (shift - 1) & 1) && ((mant & ((1U << (shift - 1)) - 1)) || (half & 1))) {
+            ++half;
+        }
+        return (unsigned short)(sign | half);
+    }
+
+    bits = ((exp - 112) << 10) | (mant >> 13);
+    if ((mant & 0x1000) && ((mant & 0xfff) || (bits & 1))) {
+        ++bits;
+    }
+    return (unsigned short)(sign | bits);
+}
+
+/* gpu pixel programs */
+
+int spxeProgram(const char* source, const int layer)
+{
+#ifndef SPXE_X11
+    int program;
+    struct spxeLayer* p;
+    if (spxe.layers.count >= SPXE_PROGRAMS || !spxe.window) {
+        fprintf(stderr, "spxe failed to add pixel program, no slot or window.\n");
+        return 0;
+    }
+
+    program = spxeLayerCompile(source);
+    glUseProgram(spxe.layers.shader);
+    if (!program) {
+        fprintf(stderr, "spxe failed to link pixel program.\n");
+        return 0;
+    }
+
+    p = spxe.layers.programs + spxe.layers.count;
+    memset(p, 0, sizeof(struct spxeLayer));
+    p->program = (unsigned int)program;
+    p->layer = layer;
+    p->time = glGetUniformLocation(p->program, "time");
+    p->resolution = glGetUniformLocation(p->program, "resolution");
+    p->params = glGetUniformLocation(p->program, "params");
+    glUseProgram(p->program);
+    glUniform1i(glGetUniformLocation(p->program, "tex"), 0);
+    glUseProgram(spxe.layers.shader);
+    return ++spxe.layers.count;
+#else
+    (void)source;
+    (void)layer;
+    fprintf(stderr, "spxe pixel programs require OpenGL.\n");
+    return 0;
+#endif
+}
+
+void spxeProgramParams(const int program, const float* params, const int count)
+{
+    if (program > 0 && program <= spxe.layers.count) {
+        const int n = count < SPXE_PARAMS ? count : SPXE_PARAMS;
+        memcpy(spxe.layers.programs[program - 1].values, params, n * sizeof(float));
+    }
+}
+
+/* dynamic resolution */
+
+/* newton steps from above the root only decrease, stop when they no longer do */
+static double spxeSqrt(const double x)
+{
+    double r = x > 1.0 ? x : 1.0, next;
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    for (next = 0.5 * (r + x / r); next < r; next = 0.5 * (r + x / r)) {
+        r = next;
+    }
+    return r;
+}
+
+static void spxeDynamicUpdate(void)
+{
+    int width, height;
+    double scale;
+
+    if (spxe.dynamic.cooldown > 0) {
+        --spxe.dynamic.cooldown;
+        return;
+    }
+
+    if (spxe.dynamic.average > spxe.dynamic.budget) {
+        scale = spxe.dynamic.budget / spxe.dynamic.average * 0.95;
+        scale = scale < 0.05 ? 0.05 : scale;
+    }
+    else if (spxe.dynamic.average < spxe.dynamic.budget * 0.6 &&
+            spxe.scrres.width < spxe.dynamic.full.width) {
+        scale = 1.2;
+    }
+    else return;
+
+    /* cost is proportional to the area, so each side scales by the square root */
+    scale = spxeSqrt(scale);
+    width = (int)((double)spxe.scrres.width * scale + 0.5);
+    width = width < spxe.dynamic.min.width ? spxe.dynamic.min.width : width;
+    width = width > spxe.dynamic.full.width ? spxe.dynamic.full.width : width;
+    height = (int)((double)width * spxe.dynamic.full.height / spxe.dynamic.full.width + 0.5);
+    height = height < spxe.dynamic.min.height ? spxe.dynamic.min.height : height;
+    height = height > spxe.dynamic.full.height ? spxe.dynamic.full.height : height;
+
+    if (width != spxe.scrres.width || height != spxe.scrres.height) {
+        spxe.dynamic.target.width = width;
+        spxe.dynamic.target.height = height;
+        spxe.dynamic.cooldown = 30;
+    }
+}
+
+void spxeResolutionBudget(const double seconds, const int minwidth, const int minheight)
+{
+    if (spxe.dynamic.budget <= 0.0) {
+        spxe.dynamic.full = spxe.scrres;
+    }
+
+    spxe.dynamic.budget = seconds;
+    spxe.dynamic.average = seconds;
+    spxe.dynamic.mark = -1.0;
+    spxe.dynamic.min.width = minwidth < 1 ? 1 : minwidth;
+    spxe.dynamic.min.height = minheight < 1 ? 1 : minheight;
+    spxe.dynamic.target = spxe.scrres;
+    if (seconds <= 0.0) {
+        spxe.dynamic.target = spxe.dynamic.full;
+    }
+}
+
+int spxeScreenResized(Px** pixbuf)
+{
+    int i, stride;
+    size_t size;
+    Px* list[SPXE_BUFFERS];
+    const int width = spxe.dynamic.target.width;
+    const int height = spxe.dynamic.target.height;
+    if ((width == spxe.scrres.width && height == spxe.scrres.height) || !width || !height) {
+        return 0;
+    }
+
+    /* every managed framebuffer is replaced, or none of them */
+    stride = spxeRowStride(width);
+    size = (size_t)stride * height * spxePixelSize();
+    for (i = 0; i < spxe.buffers.count; ++i) {
+        list[i] = i ? spxeAllocExtra(size) : spxeAlloc(size);
+        if (!list[i]) {
+            while (i--) {
+                spxeFree(list[i]);
+            }
+            spxe.dynamic.target = spxe.scrres;
+            return 0;
+        }
+    }
+
+    for (i = 0; i < spxe.buffers.count; ++i) {
+        spxeFree(spxe.buffers.list[i]);
+        spxe.buffers.list[i] = list[i];
+    }
+    *pixbuf = spxe.buffers.list[spxe.buffers.current];
+    spxe.idle.redraw = 1;
+    
+    /* the previous timings were measured on a different number of pixels */
+    spxe.dynamic.average *= (double)width * height /
+                            ((double)spxe.scrres.width * spxe.scrres.height);
+    spxe.scrres.width = width;
+    spxe.scrres.height = height;
+    spxe.stride = stride;
+    spxeFrame();
+    return 1;
+}
+
+/* window and screen size getters */
+
+void spxeWindowSize(int* width, int* height)
+{
+    *width = spxe.winres.width;
+    *height = spxe.winres.height;
+}
+
+void spxeScreenSize(int* width, int* height)
+{
+    *width = spxe.scrres.width;
+    *height = spxe.scrres.height;
+}
+
+/* time input */
+
+double spxeTime(void)
+{
+    return spxeClock();
+}
+
+/* fixed timestep */
+
+void spxeTimestep(const double step, const int maxsteps)
+{
+    spxe.clock.step = step > 0.0 ? step : 1.0 / 60.0;
+    spxe.clock.maxsteps = maxsteps > 0 ? maxsteps : 1;
+    spxe.clock.last = -1.0;
+    spxe.clock.accum = 0.0;
+}
+
+int spxeUpdate(void)
+{
+    if (spxe.clock.frame) {
+        const double t = spxeClock();
+        if (spxe.clock.last >= 0.0) {
+            spxe.clock.accum += t - spxe.clock.last;
+        }
+        spxe.clock.last = t;
+        spxe.clock.steps = 0;
+        spxe.clock.frame = 0;
+    }
+
+    if (spxe.clock.accum < spxe.clock.step) {
+        return 0;
+    }
+    
+    /* don't let a slow frame snowball into even slower ones, drop the backlog */
+    if (spxe.clock.steps == spxe.clock.maxsteps) {
+        spxe.clock.accum -= spxe.clock.step * (double)(long)(spxe.clock.accum / spxe.clock.step);
+        return 0;
+    }
+
+    spxe.clock.accum -= spxe.clock.step;
+    ++spxe.clock.steps;
+    return 1;
+}
+
+double spxeAlpha(void)
+{
+    return spxe.clock.accum / spxe.clock.step;
+}
+
+/* keyboard input */
+
+int spxeKeyDown(const int key)
+{
+    return !!spxe.input.keys[key];
+}
+
+int spxeKeyPressed(const int key)
+{
+    if (!spxe.input.pressedKeys[key] && spxe.input.keys[key]) {
+        spxe.input.pressedKeys[key] = 1;
+        return 1;
+    }
+    return 0;
+}
+
+int spxeKeyReleased(const int key)
+{
+    if (!spxe.input.keys[key] && spxe.input.pressedKeys[key]) {
+        spxe.input.pressedKeys[key] = 0;
+        return 1;
+    }
+    return 0;
+}
+
+char spxeKeyChar(void)
+{
+    char ch = 0;
+    if (spxe.input.queuedChar) {
+        ch = spxe.input.memChar;
+        spxe.input.queuedChar = 0;
+    }
+    return ch;
+}
+
+/* mouse input */
+
+void spxeMousePos(int* x, int* y)
+{
+    double dx, dy;
+    float width, height, hwidth, hheight;
+    
+    spxeCursor(&dx, &dy);
+    width = (float)spxe.scrres.width;
+    height = (float)spxe.scrres.height;
+    hwidth = width * 0.5;
+    hheight = height * 0.5;
+
+    dx = dx * (width / (float)spxe.winres.width);
+    dy = height - dy * (height / (float)spxe.winres.height);
+    *x = (int)((dx - hwidth) / spxe.ratio.width + hwidth);
+    *y = (int)((dy - hheight) / spxe.ratio.height + hheight);
+
+    /* world coordinates while there is a canvas */
+    if (spxe.canvas.data) {
+        int vx, vy;
+        spxeViewportClamp(&vx, &vy);
+        *x += vx;
+        *y += vy;
+    }
+}
+
+int spxeMouseDown(const int button)
+{
+    return spxeButton(button);
+}
+
+int spxeMousePressed(const int button)
+{
+    const int mouseButton = spxeButton(button);
+    const int pressed = (mouseButton == GLFW_PRESS) && 
+                        (spxe.input.mouseState == GLFW_RELEASE);
+    spxe.input.mouseState = mouseButton;
+    return pressed;
+}
+
+int spxeMouseReleased(const int button)
+{
+    return !spxeButton(button);
+}
+
+void spxeMouseVisible(const int visible)
+{
+#ifndef SPXE_X11
+    glfwSetInputMode(
+        spxe.window, GLFW_CURSOR, 
+        !visible ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL
+    );
+#else
+    if (visible) {
+        XUndefineCursor(spxex.display, spxex.window);
+    }
+    else XDefineCursor(spxex.display, spxex.window, spxex.hidden);
+#endif
+}
+
+/* worker threads, started on first use */
+
+#ifndef SPXE_MAX_THREADS
+    #define SPXE_MAX_THREADS 64
+#endif
+
+#ifdef SPXE_POSIX
+
+#include <pthread.h>
+
+static struct spxeWorkers {
+    pthread_t threads[SPXE_MAX_THREADS];
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    void (*func)(void*, int, int);
+    void* data;
+    int count;
+    int parts;
+    int pending;
+    int size;
+    int started;
+    int quit;
+    unsigned long generation;
+} spxew;
+
+/* part of the range [0, count) processed by each thread, 0 is the caller */
+static void spxeParallelPart(const int part)
+{
+    const int begin = (int)((double)spxew.count * part / spxew.parts);
+    const int end = (int)((double)spxew.count * (part + 1) / spxew.parts);
+    if (begin < end) {
+        spxew.func(spxew.data, begin, end);
+    }
+}
+
+static void* spxeWorker(void* arg)
+{
+    const int part = (int)(size_t)arg;
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&spxew.mutex);
+    while (1) {
+        while (generation == spxew.generation && !spxew.quit) {
+            pthread_cond_wait(&spxew.start, &spxew.mutex);
+        }
+        if (spxew.quit) {
+            break;
+        }
+
+        generation = spxew.generation;
+        pthread_mutex_unlock(&spxew.mutex);
+        spxeParallelPart(part);
+        pthread_mutex_lock(&spxew.mutex);
+        if (!--spxew.pending) {
+            pthread_cond_signal(&spxew.done);
+        }
+    }
+    pthread_mutex_unlock(&spxew.mutex);
+    return NULL;
+}
+
+static int spxeWorkersStart(void)
+{
+    int i, n = spxe.hints.threads;
+    if (spxew.started) {
+        return spxew.size;
+    }
+
+    if (n <= 0) {
+        n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    n = n < 1 ? 1 : n > SPXE_MAX_THREADS ? SPXE_MAX_THREADS : n;
+
+    pthread_mutex_init(&spxew.mutex, NULL);
+    pthread_cond_init(&spxew.start, NULL);
+    pthread_cond_init(&spxew.done, NULL);
+    for (i = 0; i < n - 1; ++i) {
+        if (pthread_create(spxew.threads + i, NULL, spxeWorker, (void*)(size_t)(i + 1))) {
+            break;
+        }
+    }
+
+    spxew.size = i;
+    spxew.started = 1;
+    return spxew.size;
+}
+
+static void spxeWorkersStop(void)
+{
+    int i;
+    if (!spxew.started) {
+        return;
+    }
+
+    pthread_mutex_lock(&spxew.mutex);
+    spxew.quit = 1;
+    pthread_cond_broadcast(&spxew.start);
+    pthread_mutex_unlock(&spxew.mutex);
+    for (i = 0; i < spxew.size; ++i) {
+        pthread_join(spxew.threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&spxew.done);
+    pthread_cond_destroy(&spxew.start);
+    pthread_mutex_destroy(&spxew.mutex);
+    /* new workers start waiting for generation 1 again */
+    spxew.size = spxew.started = spxew.quit = 0;
+    spxew.generation = 0;
+}
+
+/* calls func over [0, count) split in contiguous ranges, one per thread */
+static void spxeParallel(void (*func)(void*, int, int), void* data, const int count)
+{
+    const int workers = spxeWorkersStart();
+    if (!workers || count < 2) {
+        if (count > 0) {
+            func(data, 0, count);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&spxew.mutex);
+    spxew.func = func;
+    spxew.data = data;
+    spxew.count = count;
+    spxew.parts = workers + 1;
+    spxew.pending = workers;
+    ++spxew.generation;
+    pthread_cond_broadcast(&spxew.start);
+    pthread_mutex_unlock(&spxew.mutex);
+
+    spxeParallelPart(0);
+
+    pthread_mutex_lock(&spxew.mutex);
+    while (spxew.pending) {
+        pthread_cond_wait(&spxew.done, &spxew.mutex);
+    }
+    pthread_mutex_unlock(&spxew.mutex);
+}
+
+#else /* !SPXE_POSIX */
+
+static void spxeWorkersStop(void)
+{
+}
+
+static void spxeParallel(void (*func)(void*, int, int), void* data, const int count)
+{
+    if (count > 0) {
+        func(data, 0, count);
+    }
+}
+
+#endif /* SPXE_POSIX */
+
+/* separable filters */
+
+/* shared by the filters, the particle splatting and the rasterizer, which
+like the worker threads can only be used by one thread at a time */
+static struct spxeScratch {
+    void* data;
+    size_t size;
+} spxeScratch;
+
+struct spxeFilter {
+    Px* dst;
+    const Px* src;
+    unsigned char* tmp;
+    const float* kernel;
+    int width;
+    int height;
+    int stride;
+    int radius;
+};
+
+/* intermediate buffer between the horizontal and vertical passes */
+static void* spxeScratchAlloc(const size_t size)
+{
+    if (size > spxeScratch.size) {
+        free(spxeScratch.data);
+        spxeScratch.data = malloc(size);
+        spxeScratch.size = spxeScratch.data ? size : 0;
+    }
+    return spxeScratch.data;
+}
+
+/* largest radius whose window sums are divided with a multiply and a shift,
+exact for every sum up to 255 times the window size without overflowing 32 bits */
+#define SPXE_BOX_RADIUS 100
+#define SPXE_BOX_SHIFT 23
+
+/* rounded average of a window sum, sum + n / 2 is always below 256 * n */
+static unsigned char spxeBoxAverage(
+    const unsigned int sum, const unsigned int n, const unsigned int mul)
+{
+    const unsigned int average = mul ? ((sum + n / 2) * mul) >> SPXE_BOX_SHIFT : (sum + n / 2) / n;
+    return (unsigned char)(average < 255 ? average : 255);
+}
+
+static unsigned int spxeBoxReciprocal(const int radius)
+{
+    const unsigned int n = 2 * (unsigned int)radius + 1;
+    return radius <= SPXE_BOX_RADIUS ? ((1UL << SPXE_BOX_SHIFT) + n - 1) / n : 0;
+}
+
+/* sliding window sums, every pixel costs one add and one subtract per channel */
+static void spxeBoxRows(void* data, int begin, int end)
+{
+    int x, y, i, c;
+    const struct spxeFilter* f = (const struct spxeFilter*)data;
+    const int r = f->radius, w = f->width, n = 2 * r + 1;
+    const unsigned int mul = spxeBoxReciprocal(r);
+
+    for (y = begin; y < end; ++y) {
+        unsigned int sum[4];
+        const unsigned char* s = (const unsigned char*)(f->src + (size_t)y * f->stride);
+        unsigned char* d = f->tmp + (size_t)y * w * 4;
+
+        for (c = 0; c < 4; ++c) {
+            sum[c] = s[c] * (unsigned int)(r + 1);
+            for (i = 1; i <= r; ++i) {
+                sum[c] += s[(i < w ? i : w - 1) * 4 + c];
+            }
+        }
+
+        for (x = 0; x < w; ++x) {
+            const unsigned char* add = s + (x + r + 1 < w ? x + r + 1 : w - 1) * 4;
+            const unsigned char* sub = s + (x - r > 0 ? x - r : 0) * 4;
+            for (c = 0; c < 4; ++c) {
+                d[x * 4 + c] = spxeBoxAverage(sum[c], (unsigned int)n, mul);
+                sum[c] += add[c] - sub[c];
+            }
+        }
+    }
+}
+
+/* running sums for a band of columns, updated a whole row at a time */
+static void spxeBoxColumns(void* data, int begin, int end)
+{
+    int y, i, k;
+    const struct spxeFilter* f = (const struct spxeFilter*)data;
+    const int r = f->radius, h = f->height, n = 2 * r + 1, len = (end - begin) * 4;
+    const size_t row = (size_t)f->width * 4;
+    const unsigned char* t = f->tmp + (size_t)begin * 4;
+    const unsigned int mul = spxeBoxReciprocal(r);
+    unsigned int* sum = (unsigned int*)malloc(len * sizeof(unsigned int));
+    if (!sum) {
+        return;
+    }
+
+    for (i = 0; i < len; ++i) {
+        sum[i] = t[i] * (unsigned int)(r + 1);
+    }
+    for (k = 1; k <= r; ++k) {
+        const unsigned char* a = t + (k < h ? k : h - 1) * row;
+        for (i = 0; i < len; ++i) {
+            sum[i] += a[i];
+        }
+    }
+
+    for (y = 0; y < h; ++y) {
+        unsigned char* d = (unsigned char*)(f->dst + (size_t)y * f->stride + begin);
+        const unsigned char* add = t + (y + r + 1 < h ? y + r + 1 : h - 1) * row;
+        const unsigned char* sub = t + (y - r > 0 ? y - r : 0) * row;
+        for (i = 0; i < len; ++i) {
+            d[i] = spxeBoxAverage(sum[i], (unsigned int)n, mul);
+            sum[i] += add[i] - sub[i];
+        }
+    }
+
+    free(sum);
+}
+
+/* rows are copied with replicated edges so every tap is a flat multiply add */
+static void spxeConvolveRows(void* data, int begin, int end)
+{
+    int x, y, i, k;
+    const struct spxeFilter* f = (const struct spxeFilter*)data;
+    const int r = f->radius, w = f->width, len = w * 4;
+    float* pad = (float*)malloc((size_t)(w + 2 * r) * 4 * sizeof(float));
+    if (!pad) {
+        return;
+    }
+
+    for (y = begin; y < end; ++y) {
+        const unsigned char* s = (const unsigned char*)(f->src + (size_t)y * f->stride);
+        float* d = (float*)f->tmp + (size_t)y * len;
+        for (x = -r; x < w + r; ++x) {
+            const unsigned char* p = s + (x < 0 ? 0 : x >= w ? w - 1 : x) * 4;
+            for (i = 0; i < 4; ++i) {
+                pad[(x + r) * 4 + i] = (float)p[i];
+            }
+        }
+
+        for (i = 0; i < len; ++i) {
+            d[i] = 0.0F;
+        }
+        for (k = 0; k <= 2 * r; ++k) {
+            const float weight = f->kernel[k];
+            const float* p = pad + k * 4;
+            for (i = 0; i < len; ++i) {
+                d[i] += weight * p[i];
+            }
+        }
+    }
+
+    free(pad);
+}
+
+static void spxeConvolveColumns(void* data, int begin, int end)
+{
+    int y, i, k;
+    const struct spxeFilter* f = (const struct spxeFilter*)data;
+    const int r = f->radius, h = f->height, len = (end - begin) * 4;
+    const size_t row = (size_t)f->width * 4;
+    const float* t = (const float*)f->tmp + (size_t)begin * 4;
+    float* acc = (float*)malloc(len * sizeof(float));
+    if (!acc) {
+        return;
+    }
+
+    for (y = 0; y < h; ++y) {
+        unsigned char* d = (unsigned char*)(f->dst + (size_t)y * f->stride + begin);
+        for (i = 0; i < len; ++i) {
+            acc[i] = 0.5F;
+        }
+        for (k = -r; k <= r; ++k) {
+            const float weight = f->kernel[k + r];
+            const float* a = t + (y + k < 0 ? 0 : y + k >= h ? h - 1 : y + k) * row;
+            for (i = 0; i < len; ++i) {
+                acc[i] += weight * a[i];
+            }
+        }
+        for (i = 0; i < len; ++i) {
+            d[i] = (unsigned char)(acc[i] < 0.0F ? 0.0F : acc[i] > 255.0F ? 255.0F : acc[i]);
+        }
+    }
+
+    free(acc);
+}
+
+static void spxeCopy(Px* dst, const Px* src, const int width, const int height, const int stride)
+{
+    int y;
+    if (dst != src) {
+        for (y = 0; y < height; ++y) {
+            memcpy(dst + (size_t)y * stride, src + (size_t)y * stride, width * sizeof(Px));
+        }
+    }
+}
+
+void spxeBoxBlur(
+    Px* dst, const Px* src, const int width, const int height,
+    const int stride, const int radius)
+{
+    struct spxeFilter f;
+    if (width <= 0 || height <= 0 || radius <= 0) {
+        spxeCopy(dst, src, width, height, stride);
+        return;
+    }
+
+    f.tmp = (unsigned char*)spxeScratchAlloc((size_t)width * height * sizeof(Px));
+    if (!f.tmp) {
+        fprintf(stderr, "spxe failed to allocate filter buffer.\n");
+        return;
+    }
+
+    f.dst = dst;
+    f.src = src;
+    f.kernel = NULL;
+    f.width = width;
+    f.height = height;
+    f.stride = stride;
+    f.radius = radius;
+    spxeParallel(spxeBoxRows, &f, height);
+    spxeParallel(spxeBoxColumns, &f, width);
+}
+
+void spxeConvolve(
+    Px* dst, const Px* src, const int width, const int height,
+    const int stride, const float* kernel, const int radius)
+{
+    struct spxeFilter f;
+    if (width <= 0 || height <= 0 || radius < 0) {
+        return;
+    }
+
+    f.tmp = (unsigned char*)spxeScratchAlloc((size_t)width * height * 4 * sizeof(float));
+    if (!f.tmp) {
+        fprintf(stderr, "spxe failed to allocate filter buffer.\n");
+        return;
+    }
+
+    f.dst = dst;
+    f.src = src;
+    f.kernel = kernel;
+    f.width = width;
+    f.height = height;
+    f.stride = stride;
+    f.radius = radius;
+    spxeParallel(spxeConvolveRows, &f, height);
+    spxeParallel(spxeConvolveColumns, &f, width);
+}
+
+/* exp(x) for x <= 0 without libm, halving x until the series converges fast */
+static double spxeExp(double x)
+{
+    int i, k = 0;
+    double sum = 1.0, term = 1.0;
+    while (x < -0.5) {
+        x *= 0.5;
+        ++k;
+    }
+    for (i = 1; i < 12; ++i) {
+        term *= x / i;
+        sum += term;
+    }
+    while (k--) {
+        sum *= sum;
+    }
+    return sum;
+}
+
+void spxeGaussianBlur(
+    Px* dst, const Px* src, const int width, const int height,
+    const int stride, const float sigma)
+{
+    int i;
+    if (sigma <= 0.0F) {
+        spxeCopy(dst, src, width, height, stride);
+    }
+    else if (sigma < 3.0F) {
+        /* sampled kernel, exact for small radii */
+        float kernel[19], sum = 0.0F;
+        const int r = (int)(sigma * 3.0F + 0.999F);
+        for (i = -r; i <= r; ++i) {
+            kernel[i + r] = (float)spxeExp(-(double)(i * i) / (2.0 * sigma * sigma));
+            sum += kernel[i + r];
+        }
+        for (i = 0; i <= 2 * r; ++i) {
+            kernel[i] /= sum;
+        }
+        spxeConvolve(dst, src, width, height, stride, kernel, r);
+    }
+    else {
+        /* three box blurs with widths matching the variance, constant time per pixel */
+        const double var = 12.0 * sigma * sigma;
+        int lower = (int)spxeSqrt(var / 3.0 + 1.0), m;
+        lower -= !(lower % 2);
+        m = (int)((var - 3.0 * lower * lower - 12.0 * lower - 9.0) / (-4.0 * lower - 4.0) + 0.5);
+        for (i = 0; i < 3; ++i) {
+            const int boxwidth = i < m ? lower : lower + 2;
+            spxeBoxBlur(dst, i ? dst : src, width, height, stride, boxwidth / 2);
+        }
+    }
+}
+
+/* particles */
+
+/* below this many particles waking the workers costs more than the work */
+#ifndef SPXE_PARTICLES_SERIAL
+    #define SPXE_PARTICLES_SERIAL 16384
+#endif
+
+/* particle ranges and row bands the splatting is split into */
+#define SPXE_PARTICLES_PARTS 64
+
+struct spxeMotion {
+    spxeParticles* particles;
+    float dt;
+    float gx;
+    float gy;
+};
+
+struct spxeSplat {
+    const spxeParticles* particles;
+    Px* pixbuf;
+    int* cells;
+    int* sorted;
+    Px* colors;
+    unsigned char* bands;
+    int width;
+    int height;
+    int stride;
+    int rows;
+    int additive;
+    int offsets[SPXE_PARTICLES_PARTS][SPXE_PARTICLES_PARTS];
+    int starts[SPXE_PARTICLES_PARTS + 1];
+};
+
+spxeParticles* spxeParticlesCreate(const int capacity)
+{
+    size_t n, offset;
+    unsigned char* memory;
+    spxeParticles* particles;
+    if (capacity <= 0) {
+        return NULL;
+    }
+
+    /* every array starts on its own cache line */
+    n = ((size_t)capacity + 15) & ~(size_t)15;
+    memory = (unsigned char*)malloc(sizeof(spxeParticles) + 64 + n * 4 * 6);
+    if (!memory) {
+        fprintf(stderr, "spxe failed to allocate %d particles.\n", capacity);
+        return NULL;
+    }
+
+    particles = (spxeParticles*)memory;
+    offset = ((size_t)(memory + sizeof(spxeParticles)) + 63) & ~(size_t)63;
+    particles->x = (float*)offset;
+    particles->y = particles->x + n;
+    particles->vx = particles->y + n;
+    particles->vy = particles->vx + n;
+    particles->life = particles->vy + n;
+    particles->color = (Px*)(particles->life + n);
+    particles->count = 0;
+    particles->capacity = capacity;
+    return particles;
+}
+
+int spxeParticlesEmit(
+    spxeParticles* particles, const float x, const float y,
+    const float vx, const float vy, const Px color, const float life)
+{
+    const int i = particles->count;
+    if (i >= particles->capacity) {
+        return -1;
+    }
+
+    particles->x[i] = x;
+    particles->y[i] = y;
+    particles->vx[i] = vx;
+    particles->vy[i] = vy;
+    particles->life[i] = life;
+    particles->color[i] = color;
+    particles->count = i + 1;
+    return i;
+}
+
+/* a single pass with no branches, so the loop vectorizes */
+static void spxeParticlesMove(void* data, int begin, int end)
+{
+    int i;
+    const struct spxeMotion* m = (const struct spxeMotion*)data;
+    float* x = m->particles->x;
+    float* y = m->particles->y;
+    float* vx = m->particles->vx;
+    float* vy = m->particles->vy;
+    float* life = m->particles->life;
+    const float dt = m->dt, ax = m->gx * dt, ay = m->gy * dt;
+
+    for (i = begin; i < end; ++i) {
+        vx[i] += ax;
+        vy[i] += ay;
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        life[i] -= dt;
+    }
+}
+
+void spxeParticlesUpdate(spxeParticles* particles, const float dt, const float gx, const float gy)
+{
+    int i, n = particles->count;
+    struct spxeMotion m;
+    m.particles = particles;
+    m.dt = dt;
+    m.gx = gx;
+    m.gy = gy;
+    if (n < SPXE_PARTICLES_SERIAL) {
+        spxeParticlesMove(&m, 0, n);
+    }
+    else spxeParallel(spxeParticlesMove, &m, n);
+
+    /* dead particles are replaced by the last one */
+    for (i = 0; i < n;) {
+        if (particles->life[i] > 0.0F) {
+            ++i;
+            continue;
+        }
+        --n;
+        particles->x[i] = particles->x[n];
+        particles->y[i] = particles->y[n];
+        particles->vx[i] = particles->vx[n];
+        particles->vy[i] = particles->vy[n];
+        particles->life[i] = particles->life[n];
+        particles->color[i] = particles->color[n];
+    }
+    particles->count = n;
+}
+
+static void spxeSplatPixel(Px* d, const Px c, const int additive)
+{
+    if (additive) {
+        const int r = d->r + c.r, g = d->g + c.g, b = d->b + c.b, a = d->a + c.a;
+        d->r = (unsigned char)(r < 255 ? r : 255);
+        d->g = (unsigned char)(g < 255 ? g : 255);
+        d->b = (unsigned char)(b < 255 ? b : 255);
+        d->a = (unsigned char)(a < 255 ? a : 255);
+    }
+    else *d = c;
+}
+
+/* pixel of every particle in a range relative to the first row of its band,
+so it fits an int for any screen of less than 2^31 pixels per band, -1 when
+off screen, counted per band */
+static void spxeSplatCells(void* data, int begin, int end)
+{
+    int part, i;
+    struct spxeSplat* s = (struct spxeSplat*)data;
+    const float* x = s->particles->x;
+    const float* y = s->particles->y;
+    const int n = s->particles->count;
+    const float w = (float)s->width, h = (float)s->height;
+
+    for (part = begin; part < end; ++part) {
+        int* counts = s->offsets[part];
+        const int last = (int)((double)n * (part + 1) / SPXE_PARTICLES_PARTS);
+        memset(counts, 0, SPXE_PARTICLES_PARTS * sizeof(int));
+        for (i = (int)((double)n * part / SPXE_PARTICLES_PARTS); i < last; ++i) {
+            if (x[i] >= 0.0F && x[i] < w && y[i] >= 0.0F && y[i] < h) {
+                const int px = (int)x[i], py = (int)y[i], band = py / s->rows;
+                s->cells[i] = (py - band * s->rows) * s->stride + px;
+                s->bands[i] = (unsigned char)band;
+                ++counts[band];
+            }
+            else s->cells[i] = -1;
+        }
+    }
+}
+
+/* pixels and colors sorted by band, in the same order as in the arrays */
+static void spxeSplatOrder(void* data, int begin, int end)
+{
+    int part, i;
+    struct spxeSplat* s = (struct spxeSplat*)data;
+    const Px* color = s->particles->color;
+    const int n = s->particles->count;
+
+    for (part = begin; part < end; ++part) {
+        int* offsets = s->offsets[part];
+        const int last = (int)((double)n * (part + 1) / SPXE_PARTICLES_PARTS);
+        for (i = (int)((double)n * part / SPXE_PARTICLES_PARTS); i < last; ++i) {
+            if (s->cells[i] >= 0) {
+                const int k = offsets[s->bands[i]]++;
+                s->sorted[k] = s->cells[i];
+                s->colors[k] = color[i];
+            }
+        }
+    }
+}
+
+/* every thread owns whole bands of rows, so no two threads write the same pixel */
+static void spxeSplatBands(void* data, int begin, int end)
+{
+    int band, k;
+    const struct spxeSplat* s = (const struct spxeSplat*)data;
+    for (band = begin; band < end; ++band) {
+        Px* pixbuf = s->pixbuf + (size_t)band * s->rows * s->stride;
+        for (k = s->starts[band]; k < s->starts[band + 1]; ++k) {
+            spxeSplatPixel(pixbuf + s->sorted[k], s->colors[k], s->additive);
+        }
+    }
+}
+
+void spxeParticlesDraw(
+    const spxeParticles* particles, Px* pixbuf, const int width, const int height,
+    const int stride, const int additive)
+{
+    int i, band, part, total = 0;
+    struct spxeSplat* s;
+    const int n = particles->count;
+    const float w = (float)width, h = (float)height;
+
+    if (n < SPXE_PARTICLES_SERIAL) {
+        for (i = 0; i < n; ++i) {
+            const float x = particles->x[i], y = particles->y[i];
+            if (x >= 0.0F && x < w && y >= 0.0F && y < h) {
+                Px* d = pixbuf + (size_t)(int)y * stride + (int)x;
+                spxeSplatPixel(d, particles->color[i], additive);
+            }
+        }
+        return;
+    }
+
+    s = (struct spxeSplat*)spxeScratchAlloc(
+        sizeof(struct spxeSplat) + (size_t)n * (2 * sizeof(int) + sizeof(Px) + 1)
+    );
+    if (!s) {
+        fprintf(stderr, "spxe failed to allocate particle buffer.\n");
+        return;
+    }
+
+    s->particles = particles;
+    s->pixbuf = pixbuf;
+    s->cells = (int*)(s + 1);
+    s->sorted = s->cells + n;
+    s->colors = (Px*)(s->sorted + n);
+    s->bands = (unsigned char*)(s->colors + n);
+    s->width = width;
+    s->height = height;
+    s->stride = stride;
+    s->rows = (height + SPXE_PARTICLES_PARTS - 1) / SPXE_PARTICLES_PARTS;
+    s->additive = additive;
+    spxeParallel(spxeSplatCells, s, SPXE_PARTICLES_PARTS);
+
+    /* counts become the offset where each range writes each band */
+    for (band = 0; band < SPXE_PARTICLES_PARTS; ++band) {
+        s->starts[band] = total;
+        for (part = 0; part < SPXE_PARTICLES_PARTS; ++part) {
+            const int count = s->offsets[part][band];
+            s->offsets[part][band] = total;
+            total += count;
+        }
+    }
+    s->starts[SPXE_PARTICLES_PARTS] = total;
+
+    spxeParallel(spxeSplatOrder, s, SPXE_PARTICLES_PARTS);
+    spxeParallel(spxeSplatBands, s, SPXE_PARTICLES_PARTS);
+}
+
+void spxeParticlesFree(spxeParticles* particles)
+{
+    free(particles);
+}
+
+/* triangle rasterizer */
+
+#define SPXE_RASTER_TILE 64
+#define SPXE_RASTER_PARTS 64
+/* 1/16 pixel vertex precision, edge function products stay exact in a double */
+#define SPXE_RASTER_SUBPIXEL 16.0
+#define SPXE_RASTER_GUARD 1048576.0F
+
+struct spxeRaster {
+    Px* pixbuf;
+    void* depth;
+    const spxeVertex* vertices;
+    int* offsets;
+    int* starts;
+    int* bins;
+    int depthbits;
+    int width;
+    int height;
+    int stride;
+    int triangles;
+    int tilesx;
+    int tiles;
+};
+
+/* tiles overlapped by the bounding box of a triangle, zero if it is culled */
+static int spxeRasterBounds(const struct spxeRaster* r, const spxeVertex* v, int* bounds)
+{
+    int i;
+    float minx = v[0].x, maxx = v[0].x, miny = v[0].y, maxy = v[0].y;
+    for (i = 1; i < 3; ++i) {
+        minx = v[i].x < minx ? v[i].x : minx;
+        maxx = v[i].x > maxx ? v[i].x : maxx;
+        miny = v[i].y < miny ? v[i].y : miny;
+        maxy = v[i].y > maxy ? v[i].y : maxy;
+    }
+
+    /* also rejects NaN coordinates */
+    if (!(minx > -SPXE_RASTER_GUARD && maxx < SPXE_RASTER_GUARD &&
+          miny > -SPXE_RASTER_GUARD && maxy < SPXE_RASTER_GUARD) ||
+        maxx < 0.0F || maxy < 0.0F || minx >= (float)r->width || miny >= (float)r->height) {
+        return 0;
+    }
+
+    bounds[0] = minx > 0.0F ? (int)minx / SPXE_RASTER_TILE : 0;
+    bounds[1] = miny > 0.0F ? (int)miny / SPXE_RASTER_TILE : 0;
+    bounds[2] = (maxx < (float)r->width ? (int)maxx : r->width - 1) / SPXE_RASTER_TILE;
+    bounds[3] = (maxy < (float)r->height ? (int)maxy : r->height - 1) / SPXE_RASTER_TILE;
+    return 1;
+}
+
+static void spxeRasterCount(void* data, int begin, int end)
+{
+    int part, i, x, y, bounds[4];
+    const struct spxeRaster* r = (const struct spxeRaster*)data;
+    for (part = begin; part < end; ++part) {
+        int* counts = r->offsets + (size_t)part * r->tiles;
+        const int last = (int)((double)r->triangles * (part + 1) / SPXE_RASTER_PARTS);
+        memset(counts, 0, r->tiles * sizeof(int));
+        for (i = (int)((double)r->triangles * part / SPXE_RASTER_PARTS); i < last; ++i) {
+            if (spxeRasterBounds(r, r->vertices + 3 * i, bounds)) {
+                for (y = bounds[1]; y <= bounds[3]; ++y) {
+                    for (x = bounds[0]; x <= bounds[2]; ++x) {
+                        ++counts[y * r->tilesx + x];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* every tile lists its triangles in the order they were given */
+static void spxeRasterBin(void* data, int begin, int end)
+{
+    int part, i, x, y, bounds[4];
+    const struct spxeRaster* r = (const struct spxeRaster*)data;
+    for (part = begin; part < end; ++part) {
+        int* offsets = r->offsets + (size_t)part * r->tiles;
+        const int last = (int)((double)r->triangles * (part + 1) / SPXE_RASTER_PARTS);
+        for (i = (int)((double)r->triangles * part / SPXE_RASTER_PARTS); i < last; ++i) {
+            if (spxeRasterBounds(r, r->vertices + 3 * i, bounds)) {
+                for (y = bounds[1]; y <= bounds[3]; ++y) {
+                    for (x = bounds[0]; x <= bounds[2]; ++x) {
+                        r->bins[offsets[y * r->tilesx + x]++] = i;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* shades a span of a row from the attribute planes, plain loops the compiler can vectorize */
+static void spxeRasterSpan(
+    const struct spxeRaster* r, const size_t index, const int count,
+    const float* start, const float* step)
+{
+    int k;
+    Px* d = r->pixbuf + index;
+    if (!r->depthbits) {
+        for (k = 0; k < count; ++k) {
+            d[k].r = (unsigned char)(start[0] + step[0] * (float)k + 0.5F);
+            d[k].g = (unsigned char)(start[1] + step[1] * (float)k + 0.5F);
+            d[k].b = (unsigned char)(start[2] + step[2] * (float)k + 0.5F);
+            d[k].a = (unsigned char)(start[3] + step[3] * (float)k + 0.5F);
+        }
+        return;
+    }
+
+    for (k = 0; k < count; ++k) {
+        const float z = start[4] + step[4] * (float)k;
+        if (z < 0.0F || z > 1.0F) {
+            continue;
+        }
+        if (r->depthbits == 16) {
+            unsigned short* depth = (unsigned short*)r->depth + index + k;
+            const unsigned short q = (unsigned short)(z * 65535.0F + 0.5F);
+            if (q >= *depth) {
+                continue;
+            }
+            *depth = q;
+        }
+        else {
+            /* largest float below 2^32 */
+            unsigned int* depth = (unsigned int*)r->depth + index + k;
+            const unsigned int q = (unsigned int)(z * 4294967040.0F);
+            if (q >= *depth) {
+                continue;
+            }
+            *depth = q;
+        }
+        d[k].r = (unsigned char)(start[0] + step[0] * (float)k + 0.5F);
+        d[k].g = (unsigned char)(start[1] + step[1] * (float)k + 0.5F);
+        d[k].b = (unsigned char)(start[2] + step[2] * (float)k + 0.5F);
+        d[k].a = (unsigned char)(start[3] + step[3] * (float)k + 0.5F);
+    }
+}
+
+/* nearest subpixel, rounding halves up for negative coordinates too */
+static double spxeRasterSnap(const float f)
+{
+    const double d = (double)f * SPXE_RASTER_SUBPIXEL + 0.5;
+    const double t = (double)(long)d;
+    return t > d ? t - 1.0 : t;
+}
+
+/* pixel x of the row whose center is inside every edge, exact integers */
+static int spxeRasterInside(const double* row, const double* a, const double* bias, const int x)
+{
+    return row[0] + a[0] * x >= bias[0] && row[1] + a[1] * x >= bias[1] && row[2] + a[2] * x >= bias[2];
+}
+
+/* half-space edge functions over a tile with a top-left fill rule, rows are cut
+to the exact span inside the triangle so only its two ends are ever tested */
+static void spxeRasterTriangle(
+    const struct spxeRaster* r, const spxeVertex* triangle,
+    const int tx0, const int ty0, const int tx1, const int ty1)
+{
+    int i, c, y, x0, y0, x1, y1;
+    double X[3], Y[3], area, inv, a[3], b[3], bias[3], row[3];
+    double attrs[5][3], plane[5], stepx[5], stepy[5];
+    float start[5], step[5];
+    const spxeVertex* v[3];
+    const double half = SPXE_RASTER_SUBPIXEL * 0.5;
+
+    for (i = 0; i < 3; ++i) {
+        X[i] = spxeRasterSnap(triangle[i].x);
+        Y[i] = spxeRasterSnap(triangle[i].y);
+        v[i] = triangle + i;
+    }
+
+    /* both windings are drawn, counter clockwise from here on */
+    area = (X[1] - X[0]) * (Y[2] - Y[0]) - (Y[1] - Y[0]) * (X[2] - X[0]);
+    if (area == 0.0) {
+        return;
+    }
+    if (area < 0.0) {
+        double t = X[1];
+        X[1] = X[2];
+        X[2] = t;
+        t = Y[1];
+        Y[1] = Y[2];
+        Y[2] = t;
+        v[1] = triangle + 2;
+        v[2] = triangle + 1;
+        area = -area;
+    }
+    inv = 1.0 / area;
+
+    /* pixel bounds of the triangle inside the tile */
+    x0 = (int)((X[0] < X[1] ? (X[0] < X[2] ? X[0] : X[2]) : (X[1] < X[2] ? X[1] : X[2])) / SPXE_RASTER_SUBPIXEL);
+    x1 = (int)((X[0] > X[1] ? (X[0] > X[2] ? X[0] : X[2]) : (X[1] > X[2] ? X[1] : X[2])) / SPXE_RASTER_SUBPIXEL);
+    y0 = (int)((Y[0] < Y[1] ? (Y[0] < Y[2] ? Y[0] : Y[2]) : (Y[1] < Y[2] ? Y[1] : Y[2])) / SPXE_RASTER_SUBPIXEL);
+    y1 = (int)((Y[0] > Y[1] ? (Y[0] > Y[2] ? Y[0] : Y[2]) : (Y[1] > Y[2] ? Y[1] : Y[2])) / SPXE_RASTER_SUBPIXEL);
+    x0 = x0 > tx0 ? x0 : tx0;
+    y0 = y0 > ty0 ? y0 : ty0;
+    x1 = x1 < tx1 ? x1 : tx1;
+    y1 = y1 < ty1 ? y1 : ty1;
+
+    /* edge i is opposite to vertex i, its value is the weight of that vertex */
+    for (i = 0; i < 3; ++i) {
+        const int p = (i + 1) % 3, q = (i + 2) % 3;
+        const double dx = X[q] - X[p], dy = Y[q] - Y[p];
+        const double px = x0 * SPXE_RASTER_SUBPIXEL + half;
+        const double py = y0 * SPXE_RASTER_SUBPIXEL + half;
+        a[i] = -dy * SPXE_RASTER_SUBPIXEL;
+        b[i] = dx * SPXE_RASTER_SUBPIXEL;
+        row[i] = dx * (py - Y[p]) - dy * (px - X[p]);
+        bias[i] = (dy < 0.0 || (dy == 0.0 && dx < 0.0)) ? 0.0 : 1.0;
+        attrs[0][i] = v[i]->color.r;
+        attrs[1][i] = v[i]->color.g;
+        attrs[2][i] = v[i]->color.b;
+        attrs[3][i] = v[i]->color.a;
+        attrs[4][i] = v[i]->z;
+    }
+
+    /* colors and depth are planes over the pixels, valued at x0 of each row */
+    for (c = 0; c < 5; ++c) {
+        plane[c] = (row[0] * attrs[c][0] + row[1] * attrs[c][1] + row[2] * attrs[c][2]) * inv;
+        stepx[c] = (a[0] * attrs[c][0] + a[1] * attrs[c][1] + a[2] * attrs[c][2]) * inv;
+        stepy[c] = (b[0] * attrs[c][0] + b[1] * attrs[c][1] + b[2] * attrs[c][2]) * inv;
+        step[c] = (float)stepx[c];
+    }
+
+    for (y = y0; y <= y1; ++y) {
+        int xs, xe;
+        double lo = (double)x0, hi = (double)x1;
+
+        /* estimate of the span, then walked to its exact ends */
+        for (i = 0; i < 3; ++i) {
+            if (a[i] > 0.0) {
+                const double t = x0 + (bias[i] - row[i]) / a[i];
+                lo = t > lo ? t : lo;
+            }
+            else if (a[i] < 0.0) {
+                const double t = x0 + (bias[i] - row[i]) / a[i];
+                hi = t < hi ? t : hi;
+            }
+            else if (row[i] < bias[i]) {
+                hi = lo - 2.0;
+            }
+        }
+        if (hi >= lo - 1.0) {
+            xs = (int)lo - 1 > x0 ? (int)lo - 1 : x0;
+            xe = (int)hi + 1 < x1 ? (int)hi + 1 : x1;
+            while (xs <= xe && !spxeRasterInside(row, a, bias, xs - x0)) {
+                ++xs;
+            }
+            while (xe >= xs && !spxeRasterInside(row, a, bias, xe - x0)) {
+                --xe;
+            }
+            if (xs <= xe) {
+                for (c = 0; c < 5; ++c) {
+                    start[c] = (float)(plane[c] + stepx[c] * (xs - x0));
+                }
+                spxeRasterSpan(r, (size_t)y * r->stride + xs, xe - xs + 1, start, step);
+            }
+        }
+
+        for (i = 0; i < 3; ++i) {
+            row[i] += b[i];
+        }
+        for (c = 0; c < 5; ++c) {
+            plane[c] += stepy[c];
+        }
+    }
+}
+
+/* tiles are drawn by one thread each, so pixels and depth are never shared */
+static void spxeRasterTiles(void* data, int begin, int end)
+{
+    int tile, k;
+    const struct spxeRaster* r = (const struct spxeRaster*)data;
+    for (tile = begin; tile < end; ++tile) {
+        const int tx = (tile % r->tilesx) * SPXE_RASTER_TILE;
+        const int ty = (tile / r->tilesx) * SPXE_RASTER_TILE;
+        const int tx1 = (tx + SPXE_RASTER_TILE < r->width ? tx + SPXE_RASTER_TILE : r->width) - 1;
+        const int ty1 = (ty + SPXE_RASTER_TILE < r->height ? ty + SPXE_RASTER_TILE : r->height) - 1;
+        for (k = r->starts[tile]; k < r->starts[tile + 1]; ++k) {
+            spxeRasterTriangle(r, r->vertices + 3 * r->bins[k], tx, ty, tx1, ty1);
+        }
+    }
+}
+
+void spxeTriangles(
+    Px* pixbuf, void* depth, const int depthbits, const int width, const int height,
+    const int stride, const spxeVertex* vertices, const int count)
+{
+    int tile, part, total = 0;
+    struct spxeRaster r;
+    if (width <= 0 || height <= 0 || count < 3) {
+        return;
+    }
+    if (depth && depthbits != 16 && depthbits != 32) {
+        fprintf(stderr, "spxe failed to rasterize, depth must be 16 or 32 bits.\n");
+        return;
+    }
+
+    r.pixbuf = pixbuf;
+    r.depth = depth;
+    r.depthbits = depth ? depthbits : 0;
+    r.vertices = vertices;
+    r.width = width;
+    r.height = height;
+    r.stride = stride;
+    r.triangles = count / 3;
+    r.tilesx = (width + SPXE_RASTER_TILE - 1) / SPXE_RASTER_TILE;
+    r.tiles = r.tilesx * ((height + SPXE_RASTER_TILE - 1) / SPXE_RASTER_TILE);
+    r.offsets = (int*)spxeScratchAlloc(((size_t)SPXE_RASTER_PARTS + 1) * r.tiles * sizeof(int) + sizeof(int));
+    if (!r.offsets) {
+        fprintf(stderr, "spxe failed to allocate rasterizer bins.\n");
+        return;
+    }
+    r.starts = r.offsets + (size_t)SPXE_RASTER_PARTS * r.tiles;
+
+    /* binning counts, then offsets for every part of the triangles in every tile */
+    spxeParallel(spxeRasterCount, &r, SPXE_RASTER_PARTS);
+    for (tile = 0; tile < r.tiles; ++tile) {
+        r.starts[tile] = total;
+        for (part = 0; part < SPXE_RASTER_PARTS; ++part) {
+            int* offset = r.offsets + (size_t)part * r.tiles + tile;
+            const int n = *offset;
+            *offset = total;
+            total += n;
+        }
+    }
+    r.starts[r.tiles] = total;
+
+    r.bins = (int*)malloc((size_t)(total ? total : 1) * sizeof(int));
+    if (!r.bins) {
+        fprintf(stderr, "spxe failed to allocate rasterizer bins.\n");
+        return;
+    }
+    spxeParallel(spxeRasterBin, &r, SPXE_RASTER_PARTS);
+    spxeParallel(spxeRasterTiles, &r, r.tiles);
+    free(r.bins);
+}
+
+/* procedural generation */
+
+#define SPXE_NOISE_CHUNK 256
+/* largest sum of the simplex corners with diagonal gradients, mapped to 1 */
+#define SPXE_SIMPLEX_SCALE 70.0F
+
+struct spxeNoiseJob {
+    float* out;
+    Px* pixbuf;
+    unsigned int* random;
+    unsigned int key;
+    unsigned int counter;
+    int width;
+    int stride;
+    int octaves;
+    int type;
+    float x;
+    float y;
+    float scale;
+    Px from;
+    Px to;
+};
+
+/* integer hash with full avalanche, a bijection of 32 bit values */
+static unsigned int spxeMix(unsigned int x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+static unsigned int spxeRandomKey(const unsigned int seed)
+{
+    return spxeMix(seed + 0x9e3779b9U);
+}
+
+/* two keyed rounds of the hash, so streams of different seeds are unrelated */
+static unsigned int spxeRandomNext(const unsigned int key, const unsigned int counter)
+{
+    return spxeMix(spxeMix(counter ^ key) + key);
+}
+
+static unsigned int spxeLattice(const int x, const int y, const unsigned int key)
+{
+    return spxeMix(((unsigned int)x * 0x8da6b343U) ^ ((unsigned int)y * 0xd8163841U) ^ key);
+}
+
+static int spxeFloor(const float f)
+{
+    const int i = (int)f;
+    return i - (f < (float)i);
+}
+
+/* quintic curve, flat first and second derivatives at the lattice */
+static float spxeFade(const float t)
+{
+    return t * t * t * (t * (t * 6.0F - 15.0F) + 10.0F);
+}
+
+/* one of the four diagonal gradients, signs taken from the top bits of the hash with
+arithmetic instead of branches or a table so the loops around it vectorize */
+static float spxeGradient(const unsigned int hash, const float x, const float y)
+{
+    return x * (1.0F - (float)(int)(hash >> 30 & 2)) + y * (1.0F - (float)(int)(hash >> 29 & 2));
+}
+
+/* runs of noise along a row between -1 and 1, each added to sum with its amplitude */
+static void spxeValueRun(
+    float* sum, const int count, const float x, const float y,
+    const float step, const float amplitude, const unsigned int key)
+{
+    int i;
+    const int iy = spxeFloor(y);
+    const float v = spxeFade(y - (float)iy);
+    const float scale = 2.0F / 16777215.0F;
+    for (i = 0; i < count; ++i) {
+        const float px = x + step * (float)i;
+        const int ix = spxeFloor(px);
+        const float u = spxeFade(px - (float)ix);
+        const float a = (float)(int)(spxeLattice(ix, iy, key) >> 8) * scale;
+        const float b = (float)(int)(spxeLattice(ix + 1, iy, key) >> 8) * scale;
+        const float c = (float)(int)(spxeLattice(ix, iy + 1, key) >> 8) * scale;
+        const float d = (float)(int)(spxeLattice(ix + 1, iy + 1, key) >> 8) * scale;
+        const float ab = a + (b - a) * u, cd = c + (d - c) * u;
+        sum[i] += amplitude * (ab + (cd - ab) * v - 1.0F);
+    }
+}
+
+static void spxePerlinRun(
+    float* sum, const int count, const float x, const float y,
+    const float step, const float amplitude, const unsigned int key)
+{
+    int i;
+    const int iy = spxeFloor(y);
+    const float fy = y - (float)iy, v = spxeFade(fy);
+    for (i = 0; i < count; ++i) {
+        const float px = x + step * (float)i;
+        const int ix = spxeFloor(px);
+        const float fx = px - (float)ix, u = spxeFade(fx);
+        const float a = spxeGradient(spxeLattice(ix, iy, key), fx, fy);
+        const float b = spxeGradient(spxeLattice(ix + 1, iy, key), fx - 1.0F, fy);
+        const float c = spxeGradient(spxeLattice(ix, iy + 1, key), fx, fy - 1.0F);
+        const float d = spxeGradient(spxeLattice(ix + 1, iy + 1, key), fx - 1.0F, fy - 1.0F);
+        const float ab = a + (b - a) * u, cd = c + (d - c) * u;
+        sum[i] += amplitude * (ab + (cd - ab) * v);
+    }
+}
+
+static float spxeSimplexCorner(const unsigned int hash, const float x, const float y)
+{
+    float t = 0.5F - x * x - y * y;
+    t = t > 0.0F ? t : 0.0F;
+    t *= t;
+    return t * t * spxeGradient(hash, x, y);
+}
+
+/* skewed triangular lattice, three corners per sample instead of four */
+static void spxeSimplexRun(
+    float* sum, const int count, const float x, const float y,
+    const float step, const float amplitude, const unsigned int key)
+{
+    int i;
+    const float F2 = 0.36602540F, G2 = 0.21132487F;
+    for (i = 0; i < count; ++i) {
+        const float px = x + step * (float)i, s = (px + y) * F2;
+        const int ix = spxeFloor(px + s), iy = spxeFloor(y + s);
+        const float t = (float)(ix + iy) * G2;
+        const float x0 = px - ((float)ix - t), y0 = y - ((float)iy - t);
+        const int i1 = x0 > y0, j1 = 1 - i1;
+        const float n0 = spxeSimplexCorner(spxeLattice(ix, iy, key), x0, y0);
+        const float n1 = spxeSimplexCorner(
+            spxeLattice(ix + i1, iy + j1, key), x0 - (float)i1 + G2, y0 - (float)j1 + G2
+        );
+        const float n2 = spxeSimplexCorner(
+            spxeLattice(ix + 1, iy + 1, key), x0 - 1.0F + 2.0F * G2, y0 - 1.0F + 2.0F * G2
+        );
+        sum[i] += amplitude * (n0 + n1 + n2) * SPXE_SIMPLEX_SCALE;
+    }
+}
+
+static void spxeNoiseRun(
+    float* sum, const int count, const float x, const float y,
+    const float step, const float amplitude, const unsigned int key, const int type)
+{
+    if (type == SPXE_NOISE_SIMPLEX) {
+        spxeSimplexRun(sum, count, x, y, step, amplitude, key);
+    }
+    else if (type == SPXE_NOISE_PERLIN) {
+        spxePerlinRun(sum, count, x, y, step, amplitude, key);
+    }
+    else {
+        spxeValueRun(sum, count, x, y, step, amplitude, key);
+    }
+}
+
+/* rows of fractal noise between 0 and 1, octaves double the frequency and halve the amplitude */
+static void spxeNoiseRows(void* data, int begin, int end)
+{
+    int y, x, i, o, count;
+    float sum[SPXE_NOISE_CHUNK];
+    const struct spxeNoiseJob* n = (const struct spxeNoiseJob*)data;
+    const float norm = 0.5F / (2.0F - 1.0F / (float)(1L << (n->octaves - 1)));
+
+    for (y = begin; y < end; ++y) {
+        for (x = 0; x < n->width; x += count) {
+            float frequency = 1.0F / n->scale, amplitude = 1.0F;
+            unsigned int key = n->key;
+            count = n->width - x < SPXE_NOISE_CHUNK ? n->width - x : SPXE_NOISE_CHUNK;
+            for (i = 0; i < count; ++i) {
+                sum[i] = 0.0F;
+            }
+
+            for (o = 0; o < n->octaves; ++o) {
+                spxeNoiseRun(
+                    sum, count, (n->x + (float)x) * frequency, (n->y + (float)y) * frequency,
+                    frequency, amplitude, key, n->type
+                );
+                frequency *= 2.0F;
+                amplitude *= 0.5F;
+                key = spxeMix(key + 0x9e3779b9U);
+            }
+
+            for (i = 0; i < count; ++i) {
+                const float v = 0.5F + sum[i] * norm;
+                sum[i] = v < 0.0F ? 0.0F : v > 1.0F ? 1.0F : v;
+            }
+
+            if (n->out) {
+                float* out = n->out + (size_t)y * n->stride + x;
+                for (i = 0; i < count; ++i) {
+                    out[i] = sum[i];
+                }
+            }
+            else {
+                Px* out = n->pixbuf + (size_t)y * n->stride + x;
+                const float r = (float)n->to.r - n->from.r, g = (float)n->to.g - n->from.g;
+                const float b = (float)n->to.b - n->from.b, a = (float)n->to.a - n->from.a;
+                for (i = 0; i < count; ++i) {
+                    out[i].r = (unsigned char)((float)n->from.r + r * sum[i] + 0.5F);
+                    out[i].g = (unsigned char)((float)n->from.g + g * sum[i] + 0.5F);
+                    out[i].b = (unsigned char)((float)n->from.b + b * sum[i] + 0.5F);
+                    out[i].a = (unsigned char)((float)n->from.a + a * sum[i] + 0.5F);
+                }
+            }
+        }
+    }
+}
+
+/* blocks of a constant size, which the compiler vectorizes */
+static void spxeRandomRange(void* data, int begin, int end)
+{
+    int i, k;
+    const struct spxeNoiseJob* n = (const struct spxeNoiseJob*)data;
+    for (i = begin; i + SPXE_NOISE_CHUNK <= end; i += SPXE_NOISE_CHUNK) {
+        unsigned int* out = n->random + i;
+        const unsigned int counter = n->counter + (unsigned int)i;
+        for (k = 0; k < SPXE_NOISE_CHUNK; ++k) {
+            out[k] = spxeRandomNext(n->key, counter + (unsigned int)k);
+        }
+    }
+    for (; i < end; ++i) {
+        n->random[i] = spxeRandomNext(n->key, n->counter + (unsigned int)i);
+    }
+}
+
+static void spxeNoiseJobFill(
+    struct spxeNoiseJob* n, const int width, const int height, const int stride,
+    const float x, const float y, const float scale, const int octaves,
+    const unsigned int seed, const int type)
+{
+    n->key = spxeRandomKey(seed);
+    n->width = width;
+    n->stride = stride;
+    n->octaves = octaves < 1 ? 1 : octaves > 16 ? 16 : octaves;
+    n->type = type;
+    n->x = x;
+    n->y = y;
+    n->scale = scale > 0.0F ? scale : 1.0F;
+    spxeParallel(spxeNoiseRows, n, height);
+}
+
+unsigned int spxeRandom(const unsigned int seed, const unsigned int counter)
+{
+    return spxeRandomNext(spxeRandomKey(seed), counter);
+}
+
+void spxeRandomFill(
+    unsigned int* out, const int count, const unsigned int seed, const unsigned int counter)
+{
+    struct spxeNoiseJob n;
+    n.random = out;
+    n.key = spxeRandomKey(seed);
+    n.counter = counter;
+    spxeParallel(spxeRandomRange, &n, count);
+}
+
+float spxeNoise(const float x, const float y, const unsigned int seed, const int type)
+{
+    float v = 0.0F;
+    spxeNoiseRun(&v, 1, x, y, 0.0F, 1.0F, spxeRandomKey(seed), type);
+    v = 0.5F + 0.5F * v;
+    return v < 0.0F ? 0.0F : v > 1.0F ? 1.0F : v;
+}
+
+void spxeNoiseFill(
+    float* out, const int width, const int height, const int stride,
+    const float x, const float y, const float scale, const int octaves,
+    const unsigned int seed, const int type)
+{
+    struct spxeNoiseJob n;
+    n.out = out;
+    n.pixbuf = NULL;
+    spxeNoiseJobFill(&n, width, height, stride, x, y, scale, octaves, seed, type);
+}
+
+void spxeNoisePixels(
+    Px* pixbuf, const int width, const int height, const int stride,
+    const float x, const float y, const float scale, const int octaves,
+    const unsigned int seed, const int type, const Px from, const Px to)
+{
+    struct spxeNoiseJob n;
+    n.out = NULL;
+    n.pixbuf = pixbuf;
+    n.from = from;
+    n.to = to;
+    spxeNoiseJobFill(&n, width, height, stride, x, y, scale, octaves, seed, type);
+}
+
+/* affine blit */
+
+struct spxeBlit {
+    Px* dst;
+    const Px* src;
+    int stride;
+    int srcwidth;
+    int srcheight;
+    int srcstride;
+    int filter;
+    int x0;
+    int x1;
+    int y0;
+    double inverse[6];
+};
+
+/* 16.16 source coordinates of a destination pixel lie inside the source */
+static int spxeBlitInside(const struct spxeBlit* b, const double u, const double v)
+{
+    return u >= 0.0 && v >= 0.0 &&
+        u < (double)b->srcwidth * 65536.0 && v < (double)b->srcheight * 65536.0;
+}
+
+/* range of x where a + step * x is in [0, size), from rounded divisions */
+static void spxeBlitRange(const double a, const double step, const double size, double* lo, double* hi)
+{
+    if (step > 0.0) {
+        const double l = -a / step, h = (size - a) / step;
+        *lo = l > *lo ? l : *lo;
+        *hi = h < *hi ? h : *hi;
+    }
+    else if (step < 0.0) {
+        const double l = (size - a) / step, h = -a / step;
+        *lo = l > *lo ? l : *lo;
+        *hi = h < *hi ? h : *hi;
+    }
+    else if (a < 0.0 || a >= size) {
+        *hi = *lo - 2.0;
+    }
+}
+
+static void spxeBlitNearest(
+    Px* d, const Px* src, const int srcstride, const int count,
+    const int u, const int v, const int du, const int dv)
+{
+    int k;
+    for (k = 0; k < count; ++k) {
+        const int x = (u + du * k) >> 16, y = (v + dv * k) >> 16;
+        d[k] = src[(size_t)y * srcstride + x];
+    }
+}
+
+/* four taps weighted by 8 bit fractions, clamped at the source edges */
+static void spxeBlitBilinear(
+    Px* d, const Px* src, const int srcwidth, const int srcheight, const int srcstride,
+    const int count, const int u, const int v, const int du, const int dv)
+{
+    int k;
+    for (k = 0; k < count; ++k) {
+        const int uu = u + du * k - 32768, vv = v + dv * k - 32768;
+        const int su = uu > 0 ? uu : 0, sv = vv > 0 ? vv : 0;
+        const int x = su >> 16, y = sv >> 16;
+        const int fx = su >> 8 & 255, fy = sv >> 8 & 255;
+        const int dx = x + 1 < srcwidth, dy = y + 1 < srcheight ? srcstride : 0;
+        const Px* p = src + (size_t)y * srcstride + x;
+        const Px* q = p + dy;
+        const int w00 = (256 - fx) * (256 - fy), w01 = fx * (256 - fy);
+        const int w10 = (256 - fx) * fy, w11 = fx * fy;
+        d[k].r = (unsigned char)((p->r * w00 + p[dx].r * w01 + q->r * w10 + q[dx].r * w11 + 32768) >> 16);
+        d[k].g = (unsigned char)((p->g * w00 + p[dx].g * w01 + q->g * w10 + q[dx].g * w11 + 32768) >> 16);
+        d[k].b = (unsigned char)((p->b * w00 + p[dx].b * w01 + q->b * w10 + q[dx].b * w11 + 32768) >> 16);
+        d[k].a = (unsigned char)((p->a * w00 + p[dx].a * w01 + q->a * w10 + q[dx].a * w11 + 32768) >> 16);
+    }
+}
+
+/* every row is cut up front to the span that maps inside the source, so the
+inner loops only step fixed point coordinates and never test bounds */
+static void spxeBlitRows(void* data, int begin, int end)
+{
+    int y;
+    const struct spxeBlit* b = (const struct spxeBlit*)data;
+    const double* m = b->inverse;
+    const double du = (double)(long)(m[0] * 65536.0 + (m[0] < 0.0 ? -0.5 : 0.5));
+    const double dv = (double)(long)(m[3] * 65536.0 + (m[3] < 0.0 ? -0.5 : 0.5));
+    const double width = b->srcwidth * 65536.0, height = b->srcheight * 65536.0;
+
+    for (y = begin + b->y0; y < end + b->y0; ++y) {
+        int xs, xe, su, sv, sdu, sdv;
+        double lo = (double)b->x0, hi = (double)b->x1;
+        const double cy = y + 0.5, cx = 0.5;
+        const double fu = (m[0] * cx + m[1] * cy + m[2]) * 65536.0;
+        const double fv = (m[3] * cx + m[4] * cy + m[5]) * 65536.0;
+        const double u = (double)(long)(fu + (fu < 0.0 ? -0.5 : 0.5));
+        const double v = (double)(long)(fv + (fv < 0.0 ? -0.5 : 0.5));
+
+        spxeBlitRange(u, du, width, &lo, &hi);
+        spxeBlitRange(v, dv, height, &lo, &hi);
+        if (hi < lo - 1.0) {
+            continue;
+        }
+
+        /* one pixel wider to absorb the divisions, then walked to the exact ends */
+        xs = (int)lo - 1 > b->x0 ? (int)lo - 1 : b->x0;
+        xe = (int)hi + 1 < b->x1 ? (int)hi + 1 : b->x1;
+        while (xs <= xe && !spxeBlitInside(b, u + du * xs, v + dv * xs)) {
+            ++xs;
+        }
+        while (xe >= xs && !spxeBlitInside(b, u + du * xe, v + dv * xe)) {
+            --xe;
+        }
+        if (xs > xe) {
+            continue;
+        }
+
+        /* a step larger than the source leaves a single pixel and is never taken */
+        su = (int)(u + du * xs);
+        sv = (int)(v + dv * xs);
+        sdu = xe > xs ? (int)du : 0;
+        sdv = xe > xs ? (int)dv : 0;
+
+        if (b->filter == SPXE_BILINEAR) {
+            spxeBlitBilinear(
+                b->dst + (size_t)y * b->stride + xs, b->src, b->srcwidth, b->srcheight,
+                b->srcstride, xe - xs + 1, su, sv, sdu, sdv
+            );
+        }
+        else {
+            spxeBlitNearest(
+                b->dst + (size_t)y * b->stride + xs, b->src, b->srcstride,
+                xe - xs + 1, su, sv, sdu, sdv
+            );
+        }
+    }
+}
+
+void spxeBlitAffine(
+    Px* pixbuf, const int width, const int height, const int stride,
+    const Px* src, const int srcwidth, const int srcheight, const int srcstride,
+    const float* matrix, const int filter)
+{
+    int i;
+    struct spxeBlit b;
+    double minx, maxx, miny, maxy;
+    const double det = (double)matrix[0] * matrix[4] - (double)matrix[1] * matrix[3];
+    if (width <= 0 || height <= 0 || srcwidth <= 0 || srcheight <= 0 || det == 0.0) {
+        return;
+    }
+    if (srcwidth > 32767 || srcheight > 32767) {
+        fprintf(stderr, "spxe failed to blit, source larger than 32767 pixels.\n");
+        return;
+    }
+
+    /* destination bounds of the source corners */
+    minx = miny = 1e30;
+    maxx = maxy = -1e30;
+    for (i = 0; i < 4; ++i) {
+        const double sx = i & 1 ? srcwidth : 0, sy = i & 2 ? srcheight : 0;
+        const double x = matrix[0] * sx + matrix[1] * sy + matrix[2];
+        const double y = matrix[3] * sx + matrix[4] * sy + matrix[5];
+        minx = x < minx ? x : minx;
+        maxx = x > maxx ? x : maxx;
+        miny = y < miny ? y : miny;
+        maxy = y > maxy ? y : maxy;
+    }
+    if (!(maxx > 0.0 && maxy > 0.0 && minx < width && miny < height)) {
+        return;
+    }
+
+    b.dst = pixbuf;
+    b.src = src;
+    b.stride = stride;
+    b.srcwidth = srcwidth;
+    b.srcheight = srcheight;
+    b.srcstride = srcstride;
+    b.filter = filter;
+    b.x0 = minx > 0.0 ? (int)minx : 0;
+    b.y0 = miny > 0.0 ? (int)miny : 0;
+    b.x1 = maxx < width ? (int)maxx : width - 1;
+    maxy = maxy < height ? maxy : height - 1;
+
+    /* destination to source, the inverse of the matrix */
+    b.inverse[0] = matrix[4] / det;
+    b.inverse[1] = -matrix[1] / det;
+    b.inverse[2] = -(b.inverse[0] * matrix[2] + b.inverse[1] * matrix[5]);
+    b.inverse[3] = -matrix[3] / det;
+    b.inverse[4] = matrix[0] / det;
+    b.inverse[5] = -(b.inverse[3] * matrix[2] + b.inverse[4] * matrix[5]);
+    spxeParallel(spxeBlitRows, &b, (int)maxy - b.y0 + 1);
+}
+
+/* frame history */
+
+#ifndef SPXE_HISTORY_KEYFRAMES
+    #define SPXE_HISTORY_KEYFRAMES 60
+#endif
+
+/* zero runs shorter than this are stored as literals, which bounds the encoded size */
+#define SPXE_HISTORY_RUN 4
+
+struct spxeHistoryEntry {
+    unsigned char* data;
+    size_t size;
+    double time;
+    unsigned long sequence;
+    int width;
+    int height;
+    int key;
+};
+
+static struct spxeHistory {
+    struct spxeHistoryEntry* entries;
+    int first;
+    int count;
+    int capacity;
+    size_t bytes;
+    size_t budget;
+    double seconds;
+    /* captured frame, handed to the encoder */
+    const Px* frame;
+    unsigned int* input;
+    size_t inputsize;
+    int inputwidth;
+    int inputheight;
+    double inputtime;
+    int ready;
+    /* encoder state */
+    unsigned int* previous;
+    size_t previoussize;
+    int previouswidth;
+    int previousheight;
+    unsigned char* scratch;
+    size_t scratchsize;
+    unsigned long sequence;
+    int sincekey;
+    /* last decoded frame, the start of the next decode */
+    unsigned int* decoded;
+    size_t decodedsize;
+    unsigned long decodedsequence;
+    int decodedvalid;
+    unsigned long dropped;
+    int paused;
+    int started;
+#ifdef SPXE_POSIX
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int quit;
+#endif
+} spxeh;
+
+static struct spxeHistoryEntry* spxeHistoryAt(const int i)
+{
+    return spxeh.entries + (spxeh.first + i) % spxeh.capacity;
+}
+
+static size_t spxeHistoryWords(const int width, const int height)
+{
+    return (size_t)width * height * spxePixelSize() / sizeof(unsigned int);
+}
+
+static unsigned char* spxeHistoryVarint(unsigned char* out, size_t n)
+{
+    while (n >= 128) {
+        *out++ = (unsigned char)(n | 128);
+        n >>= 7;
+    }
+    *out++ = (unsigned char)n;
+    return out;
+}
+
+static const unsigned char* spxeHistoryVarintRead(const unsigned char* in, size_t* n)
+{
+    int shift = 0;
+    *n = 0;
+    do {
+        *n |= (size_t)(*in & 127) << shift;
+        shift += 7;
+    } while (*in++ & 128);
+    return in;
+}
+
+/* xor against the previous frame, stored as runs of unchanged words and literal words */
+static size_t spxeHistoryEncode(
+    unsigned char* out, const unsigned int* frame, const unsigned int* previous, const size_t n)
+{
+    size_t i = 0;
+    unsigned char* start = out;
+    while (i < n) {
+        size_t zeros = i, literals;
+        while (i < n && frame[i] == (previous ? previous[i] : 0)) {
+            ++i;
+        }
+        zeros = i - zeros;
+
+        literals = i;
+        while (i < n) {
+            size_t run = i;
+            while (run < n && run - i < SPXE_HISTORY_RUN && frame[run] == (previous ? previous[run] : 0)) {
+                ++run;
+            }
+            if (run - i >= SPXE_HISTORY_RUN || run == n) {
+                break;
+            }
+            i = run + 1;
+        }
+        i = i < n ? i : n;
+        literals = i - literals;
+
+        out = spxeHistoryVarint(out, zeros);
+        out = spxeHistoryVarint(out, literals);
+        for (; literals; --literals, out += sizeof(unsigned int)) {
+            const size_t k = i - literals;
+            const unsigned int word = frame[k] ^ (previous ? previous[k] : 0);
+            memcpy(out, &word, sizeof(unsigned int));
+        }
+    }
+    return (size_t)(out - start);
+}
+
+/* xor deltas are their own inverse, the same pass steps a frame forward or backward */
+static void spxeHistoryApply(unsigned int* frame, const struct spxeHistoryEntry* entry)
+{
+    size_t i = 0, zeros, literals;
+    const size_t n = spxeHistoryWords(entry->width, entry->height);
+    const unsigned char* in = entry->data;
+    if (entry->key) {
+        memset(frame, 0, n * sizeof(unsigned int));
+    }
+
+    while (i < n) {
+        in = spxeHistoryVarintRead(in, &zeros);
+        in = spxeHistoryVarintRead(in, &literals);
+        i += zeros;
+        for (; literals && i < n; --literals, ++i, in += sizeof(unsigned int)) {
+            unsigned int word;
+            memcpy(&word, in, sizeof(unsigned int));
+            frame[i] ^= word;
+        }
+    }
+}
+
+static void spxeHistoryEvict(void)
+{
+    struct spxeHistoryEntry* entry = spxeHistoryAt(0);
+    spxeh.bytes -= entry->size;
+    free(entry->data);
+    spxeh.first = (spxeh.first + 1) % spxeh.capacity;
+    --spxeh.count;
+}
+
+/* drops the oldest keyframes with the deltas that depend on them until the new entry fits */
+static int spxeHistoryAppend(const struct spxeHistoryEntry* entry)
+{
+    while (spxeh.count && (spxeh.bytes + entry->size > spxeh.budget ||
+            entry->time - spxeHistoryAt(0)->time > spxeh.seconds)) {
+        spxeHistoryEvict();
+        while (spxeh.count && !spxeHistoryAt(0)->key) {
+            spxeHistoryEvict();
+        }
+    }
+    if ((!entry->key && !spxeh.count) || entry->size > spxeh.budget) {
+        return 0;
+    }
+
+    if (spxeh.count == spxeh.capacity) {
+        int i;
+        const int capacity = spxeh.capacity ? spxeh.capacity * 2 : 256;
+        struct spxeHistoryEntry* entries = (struct spxeHistoryEntry*)malloc(
+            capacity * sizeof(struct spxeHistoryEntry)
+        );
+        if (!entries) {
+            return 0;
+        }
+        for (i = 0; i < spxeh.count; ++i) {
+            entries[i] = *spxeHistoryAt(i);
+        }
+        free(spxeh.entries);
+        spxeh.entries = entries;
+        spxeh.capacity = capacity;
+        spxeh.first = 0;
+    }
+
+    *spxeHistoryAt(spxeh.count++) = *entry;
+    spxeh.bytes += entry->size;
+    return 1;
+}
+
+/* encodes the captured frame against the previous one, outside of the lock */
+static void spxeHistoryEncodeFrame(void)
+{
+    struct spxeHistoryEntry entry;
+    const size_t n = spxeHistoryWords(spxeh.inputwidth, spxeh.inputheight);
+    const size_t bound = n * sizeof(unsigned int) + (n / SPXE_HISTORY_RUN + 2) * 20;
+    int appended;
+
+    entry.key = spxeh.sincekey >= SPXE_HISTORY_KEYFRAMES ||
+        spxeh.previouswidth != spxeh.inputwidth || spxeh.previousheight != spxeh.inputheight;
+    if (spxeh.scratchsize < bound) {
+        free(spxeh.scratch);
+        spxeh.scratch = (unsigned char*)malloc(bound);
+        spxeh.scratchsize = spxeh.scratch ? bound : 0;
+    }
+    if (spxeh.previoussize < n) {
+        free(spxeh.previous);
+        spxeh.previous = (unsigned int*)malloc(n * sizeof(unsigned int));
+        spxeh.previoussize = spxeh.previous ? n : 0;
+        entry.key = 1;
+    }
+    if (!spxeh.scratch || !spxeh.previous) {
+        spxeh.previouswidth = 0;
+        return;
+    }
+
+    entry.size = spxeHistoryEncode(spxeh.scratch, spxeh.input, entry.key ? NULL : spxeh.previous, n);
+    entry.data = (unsigned char*)malloc(entry.size ? entry.size : 1);
+    entry.time = spxeh.inputtime;
+    entry.width = spxeh.inputwidth;
+    entry.height = spxeh.inputheight;
+    if (!entry.data) {
+        spxeh.previouswidth = 0;
+        return;
+    }
+    memcpy(entry.data, spxeh.scratch, entry.size);
+    memcpy(spxeh.previous, spxeh.input, n * sizeof(unsigned int));
+    spxeh.previouswidth = spxeh.inputwidth;
+    spxeh.previousheight = spxeh.inputheight;
+
+#ifdef SPXE_POSIX
+    pthread_mutex_lock(&spxeh.mutex);
+#endif
+    entry.sequence = spxeh.sequence;
+    appended = spxeHistoryAppend(&entry);
+    if (appended) {
+        ++spxeh.sequence;
+    }
+#ifdef SPXE_POSIX
+    pthread_mutex_unlock(&spxeh.mutex);
+#endif
+
+    /* a delta without its keyframe can't be decoded, the next frame starts over */
+    if (!appended) {
+        free(entry.data);
+        spxeh.previouswidth = 0;
+    }
+    spxeh.sincekey = entry.key ? 1 : spxeh.sincekey + 1;
+}
+
+#ifdef SPXE_POSIX
+
+static void* spxeHistoryWorker(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&spxeh.mutex);
+    while (1) {
+        while (!spxeh.ready && !spxeh.quit) {
+            pthread_cond_wait(&spxeh.wake, &spxeh.mutex);
+        }
+        if (spxeh.quit) {
+            break;
+        }
+
+        pthread_mutex_unlock(&spxeh.mutex);
+        SPXE_TRACE_BEGIN("history");
+        spxeHistoryEncodeFrame();
+        SPXE_TRACE_END();
+        pthread_mutex_lock(&spxeh.mutex);
+        spxeh.ready = 0;
+        pthread_cond_signal(&spxeh.done);
+    }
+    pthread_mutex_unlock(&spxeh.mutex);
+    return NULL;
+}
+
+#endif /* SPXE_POSIX */
+
+/* copies the presented frame for the encoder, skipped while it is still busy with the last one */
+static void spxeHistoryCapture(void)
+{
+    int y, stride, busy;
+    const Px* pixbuf = spxeh.frame;
+    const int width = spxe.scrres.width, height = spxe.scrres.height;
+    const size_t n = spxeHistoryWords(width, height);
+    const size_t row = (size_t)width * spxePixelSize();
+
+    spxeh.frame = NULL;
+    if (!spxeh.started || spxeh.paused || !pixbuf) {
+        return;
+    }
+
+#ifdef SPXE_POSIX
+    pthread_mutex_lock(&spxeh.mutex);
+    busy = spxeh.ready;
+    pthread_mutex_unlock(&spxeh.mutex);
+#else
+    busy = 0;
+#endif
+    if (busy) {
+        ++spxeh.dropped;
+        return;
+    }
+
+    SPXE_TRACE_BEGIN("capture");
+    if (spxeh.inputsize < n) {
+        free(spxeh.input);
+        spxeh.input = (unsigned int*)malloc(n * sizeof(unsigned int));
+        spxeh.inputsize = spxeh.input ? n : 0;
+    }
+    if (!spxeh.input) {
+        SPXE_TRACE_END();
+        return;
+    }
+
+    pixbuf = spxeSource(pixbuf, &stride);
+    for (y = 0; y < height; ++y) {
+        memcpy(
+            (unsigned char*)spxeh.input + row * y,
+            (const unsigned char*)pixbuf + (size_t)y * stride * spxePixelSize(), row
+        );
+    }
+    spxeh.inputwidth = width;
+    spxeh.inputheight = height;
+    spxeh.inputtime = spxeTime();
+    SPXE_TRACE_END();
+
+#ifdef SPXE_POSIX
+    pthread_mutex_lock(&spxeh.mutex);
+    spxeh.ready = 1;
+    pthread_cond_signal(&spxeh.wake);
+    pthread_mutex_unlock(&spxeh.mutex);
+#else
+    spxeHistoryEncodeFrame();
+#endif
+}
+
+static void spxeHistoryStop(void)
+{
+    if (!spxeh.started) {
+        return;
+    }
+
+#ifdef SPXE_POSIX
+    pthread_mutex_lock(&spxeh.mutex);
+    spxeh.quit = 1;
+    pthread_cond_signal(&spxeh.wake);
+    pthread_mutex_unlock(&spxeh.mutex);
+    pthread_join(spxeh.thread, NULL);
+    pthread_cond_destroy(&spxeh.done);
+    pthread_cond_destroy(&spxeh.wake);
+    pthread_mutex_destroy(&spxeh.mutex);
+#endif
+
+    while (spxeh.count) {
+        spxeHistoryEvict();
+    }
+    free(spxeh.entries);
+    free(spxeh.input);
+    free(spxeh.previous);
+    free(spxeh.scratch);
+    free(spxeh.decoded);
+    memset(&spxeh, 0, sizeof(spxeh));
+}
+
+int spxeHistory(const double seconds, const unsigned long budget)
+{
+    spxeHistoryStop();
+    if (seconds <= 0.0 || !budget) {
+        return 1;
+    }
+
+    spxeh.seconds = seconds;
+    spxeh.budget = (size_t)budget;
+#ifdef SPXE_POSIX
+    pthread_mutex_init(&spxeh.mutex, NULL);
+    pthread_cond_init(&spxeh.wake, NULL);
+    pthread_cond_init(&spxeh.done, NULL);
+    if (pthread_create(&spxeh.thread, NULL, spxeHistoryWorker, NULL)) {
+        fprintf(stderr, "spxe failed to start history thread.\n");
+        pthread_cond_destroy(&spxeh.done);
+        pthread_cond_destroy(&spxeh.wake);
+        pthread_mutex_destroy(&spxeh.mutex);
+        memset(&spxeh, 0, sizeof(spxeh));
+        return 0;
+    }
+#endif
+    spxeh.started = 1;
+    return 1;
+}
+
+void spxeHistoryPause(const int pause)
+{
+    spxeh.paused = pause;
+}
+
+/* recording continues from a rewound frame, the frame after it is a keyframe */
+void spxeHistoryDrop(const int count)
+{
+    int i;
+    if (!spxeh.started) {
+        return;
+    }
+
+#ifdef SPXE_POSIX
+    pthread_mutex_lock(&spxeh.mutex);
+    while (spxeh.ready) {
+        pthread_cond_wait(&spxeh.done, &spxeh.mutex);
+    }
+#endif
+    for (i = 0; i < count && spxeh.count; ++i) {
+        struct spxeHistoryEntry* entry = spxeHistoryAt(--spxeh.count);
+        spxeh.bytes -= entry->size;
+        free(entry->data);
+    }
+    if (spxeh.count) {
+        spxeh.sequence = spxeHistoryAt(spxeh.count - 1)->sequence + 1;
+    }
+    spxeh.decodedvalid = 0;
+    spxeh.previouswidth = 0;
+#ifdef SPXE_POSIX
+    pthread_mutex_unlock(&spxeh.mutex);
+#endif
+}
+
+int spxeHistoryCount(void)
+{
+    int count;
+    if (!spxeh.started) {
+        return 0;
+    }
+#ifdef SPXE_POSIX
+    pthread_mutex_lock(&spxeh.mutex);
+#endif
+    count = spxeh.count;
+#ifdef SPXE_POSIX
+    pthread_mutex_unlock(&spxeh.mutex);
+#endif
+    return count;
+}
+
+/* only written by spxeStep() on the calling thread, no lock needed */
+unsigned long spxeHistoryDropped(void)
+{
+    return spxeh.dropped;
+}
+
+/* decoded from the cheapest start: the last decoded frame stepped forward or back,
+or the closest keyframe before the one requested */
+static const Px* spxeHistoryDecode(const int index, int* widthptr, int* heightptr, double* timeptr)
+{
+    int i, key, from;
+    const int target = spxeh.count - 1 - index;
+    const struct spxeHistoryEntry* entry;
+    const size_t n = spxeHistoryWords(spxeHistoryAt(target)->width, spxeHistoryAt(target)->height);
+
+    for (key = target; !spxeHistoryAt(key)->key; --key);
+    from = -1;
+    if (spxeh.decodedvalid && spxeh.decodedsequence >= spxeHistoryAt(0)->sequence) {
+        from = (int)(spxeh.decodedsequence - spxeHistoryAt(0)->sequence);
+        from = from < spxeh.count ? from : -1;
+    }
+
+    if (from >= key && from <= target) {
+        for (i = from + 1; i <= target; ++i) {
+            spxeHistoryApply(spxeh.decoded, spxeHistoryAt(i));
+        }
+    }
+    else if (from > target && from - target < target - key + 1) {
+        for (i = from; i > target && !spxeHistoryAt(i)->key; --i) {
+            spxeHistoryApply(spxeh.decoded, spxeHistoryAt(i));
+        }
+        if (i > target) {
+            from = -1;
+        }
+    }
+    else from = -1;
+
+    if (from < 0) {
+        if (spxeh.decodedsize < n) {
+            free(spxeh.decoded);
+            spxeh.decoded = (unsigned int*)malloc(n * sizeof(unsigned int));
+            spxeh.decodedsize = spxeh.decoded ? n : 0;
+        }
+        if (!spxeh.decoded) {
+            spxeh.decodedvalid = 0;
+            return NULL;
+        }
+        for (i = key; i <= target; ++i) {
+            spxeHistoryApply(spxeh.decoded, spxeHistoryAt(i));
+        }
+    }
+
+    entry = spxeHistoryAt(target);
+    spxeh.decodedsequence = entry->sequence;
+    spxeh.decodedvalid = 1;
+    if (widthptr) {
+        *widthptr = entry->width;
+    }
+    if (heightptr) {
+        *heightptr = entry->height;
+    }
+    if (timeptr) {
+        *timeptr = entry->time;
+    }
+    return (const Px*)spxeh.decoded;
+}
+
+const Px* spxeHistoryFrame(const int index, int* widthptr, int* heightptr, double* timeptr)
+{
+    const Px* frame = NULL;
+    if (!spxeh.started) {
+        return NULL;
+    }
+
+#ifdef SPXE_POSIX
+    pthread_mutex_lock(&spxeh.mutex);
+#endif
+    if (index >= 0 && index < spxeh.count) {
+        SPXE_TRACE_BEGIN("rewind");
+        frame = spxeHistoryDecode(index, widthptr, heightptr, timeptr);
+        SPXE_TRACE_END();
+    }
+#ifdef SPXE_POSIX
+    pthread_mutex_unlock(&spxeh.mutex);
+#endif
+    return frame;
+}
+
+/* spxe core */
+
+Px* spxeStart(          
+    const char* title,  const int winwidth, const int winheight, 
+    const int scrwidth, const int scrheight)
+{
+    Px* pixbuf;
+    const int stride = spxeRowStride(scrwidth);
+    const size_t scrsize = (size_t)stride * scrheight;
+
+    /* set global information */
+    spxe.winres.width = winwidth;
+    spxe.winres.height = winheight;
+    spxe.scrres.width = scrwidth;
+    spxe.scrres.height = scrheight;
+    spxe.stride = stride;
+
+    /* open window and render context */
+    if (!spxeOpen(title)) {
+        return NULL;
+    }
+    
+    /* allocate pixel framebuffer */
+    pixbuf = spxeAlloc(scrsize * spxePixelSize());
+    if (!pixbuf) {
+        fprintf(stderr, "spxe failed to allocate pixel framebuffer.\n");
+        return NULL;
+    }
+
+    spxe.buffers.list[0] = pixbuf;
+    spxe.buffers.count = 1;
+    spxe.buffers.current = 0;
+    return pixbuf;
+}
+
+void spxeBackgroundColor(const Px c)
+{
+#ifndef SPXE_X11
+    const float n = 1.0F / 255.0F;
+    glClearColor((float)c.r * n, (float)c.g * n, (float)c.b * n, (float)c.a * n);
+#else
+    spxex.background = spxeX11Pixel(c);
+#endif
+    spxe.idle.redraw = 1;
+}
+
+/* idle mode */
+
+void spxeIdle(const double timeout, const int hash)
+{
+    spxe.idle.timeout = timeout;
+    spxe.idle.hash = hash;
+    spxe.idle.redraw = 1;
+}
+
+void spxeRedraw(void)
+{
+    spxe.idle.redraw = 1;
+}
+
+/* banded rendering */
+
+void spxeBand(const Px* pixbuf, const int y, const int rows)
+{
+    const int first = y > 0 ? y : 0;
+    const int last = y + rows < spxe.scrres.height ? y + rows : spxe.scrres.height;
+    if (first < last) {
+        spxeUploadBand(pixbuf, first, last - first);
+        spxe.bands.uploaded = 1;
+    }
+}
+
+/* independent lanes the compiler can vectorize, one multiply per word */
+static void spxeIdleHash(const Px* pixbuf, unsigned int* hash)
+{
+    int y, stride;
+    size_t i, j;
+    unsigned int words[SPXE_IDLE_LANES];
+    const size_t block = sizeof(words);
+    const unsigned char* data = (const unsigned char*)spxeSource(pixbuf, &stride);
+    const size_t pitch = (size_t)stride * spxePixelSize();
+    size_t size = (size_t)spxe.scrres.width * spxePixelSize();
+    int rows = spxe.scrres.height;
+
+    /* contiguous rows are hashed as a single one */
+    if (pitch == size || (const Px*)data == pixbuf) {
+        size = pitch * rows;
+        rows = 1;
+    }
+
+    for (j = 0; j < SPXE_IDLE_LANES; ++j) {
+        hash[j] = 2166136261U;
+    }
+    for (y = 0; y < rows; ++y, data += pitch) {
+        for (i = 0; i + block <= size; i += block) {
+            memcpy(words, data + i, block);
+            for (j = 0; j < SPXE_IDLE_LANES; ++j) {
+                hash[j] = (hash[j] ^ words[j]) * 16777619U;
+            }
+        }
+        for (; i < size; ++i) {
+            hash[0] = (hash[0] ^ data[i]) * 16777619U;
+        }
+    }
+}
+
+/* returns non-zero when the render is deferred because it matches the last frame */
+static int spxeIdleDefer(const Px* pixbuf)
+{
+    int changed;
+    const int n = spxe.idle.renders++;
+    if (n >= SPXE_IDLE_RENDERS) {
+        return 0;
+    }
+
+    /* programs are animated, they draw a different frame every time */
+    changed = spxe.idle.redraw || spxe.idle.drawn || spxe.layers.count;
+    if (spxe.idle.hash) {
+        unsigned int hash[SPXE_IDLE_LANES];
+        SPXE_TRACE_BEGIN("hash");
+        spxeIdleHash(pixbuf, hash);
+        SPXE_TRACE_END();
+        changed |= memcmp(hash, spxe.idle.hashes[n], sizeof(hash)) != 0;
+        memcpy(spxe.idle.hashes[n], hash, sizeof(hash));
+    }
+
+    spxe.idle.pending[n] = pixbuf;
+    return !changed;
+}
+
+/* draws the renders of this frame that were deferred before a change showed up */
+static void spxeIdleFlush(const int count)
+{
+    int i;
+    if (spxe.idle.drawn) {
+        return;
+    }
+    spxe.idle.drawn = 1;
+    for (i = 0; i < count && i < SPXE_IDLE_RENDERS; ++i) {
+        SPXE_TRACE_BEGIN("spxeRender");
+        spxeUpload(spxe.idle.pending[i]);
+        SPXE_TRACE_END();
+    }
+}
+
+static int spxeIdleUnchanged(void)
+{
+    return  spxe.idle.timeout > 0.0 && !spxe.idle.drawn && !spxe.idle.redraw &&
+            !spxe.layers.count && spxe.idle.renders == spxe.idle.previous &&
+            spxe.idle.renders <= SPXE_IDLE_RENDERS;
+}
+
+void spxeRender(const Px* pixbuf)
+{
+    if (spxe.dynamic.budget > 0.0 && !spxe.dynamic.measured && spxe.dynamic.mark >= 0.0) {
+        const double t = spxeClock() - spxe.dynamic.mark;
+        spxe.dynamic.average += (t - spxe.dynamic.average) * 0.1;
+        spxe.dynamic.measured = 1;
+    }
+
+    spxeh.frame = pixbuf;
+    if (spxe.idle.timeout > 0.0) {
+        if (spxeIdleDefer(pixbuf)) {
+            spxe.bands.uploaded = 0;
+            return;
+        }
+        spxeIdleFlush(spxe.idle.renders - 1);
+    }
+
+    SPXE_TRACE_BEGIN("spxeRender");
+    if (spxe.bands.uploaded) {
+        spxe.bands.uploaded = 0;
+        spxeUploadBands(pixbuf);
+    }
+    else spxeUpload(pixbuf);
+    SPXE_TRACE_END();
+}
+
+int spxeStep(void)
+{ 
+    int ret;
+    SPXE_TRACE_BEGIN("spxeStep");
+    if (spxeIdleUnchanged()) {
+        ret = spxeWait(spxe.idle.timeout);
+    }
+    else {
+        if (spxe.idle.timeout > 0.0) {
+            spxeIdleFlush(spxe.idle.renders);
+        }
+        spxe.idle.redraw = 0;
+        spxeHistoryCapture();
+        ret = spxePresent();
+    }
+    SPXE_TRACE_END();
+    spxe.idle.previous = spxe.idle.renders;
+    spxe.idle.renders = 0;
+    spxe.idle.drawn = 0;
+    spxe.clock.frame = 1;
+    if (spxe.dynamic.budget > 0.0) {
+        if (spxe.dynamic.measured) {
+            spxeDynamicUpdate();
+        }
+        spxe.dynamic.mark = spxeClock();
+        spxe.dynamic.measured = 0;
+    }
+    return ret;
+}
+
+int spxeRun(const Px* pixbuf)
+{
+    spxeRender(pixbuf);
+    return spxeStep();
+}
+
+int spxeLoop(
+    const Px* pixbuf,   int (*update)(void*, double),   
+    void (*draw)(void*, double),    void* data)
+{
+    int updated = 1;
+    while (1) {
+        /* without draw the buffer only changes in update, so a frame without
+        steps waits for the next one instead of presenting the same pixels */
+        if (updated || draw || spxe.idle.redraw || spxe.layers.count) {
+            if (!spxeRun(pixbuf)) {
+                return 0;
+            }
+        }
+        else {
+            const double timeout = spxe.clock.step - spxe.clock.accum;
+            if (!spxeWait(timeout > 0.0 ? timeout : 0.0)) {
+                return 0;
+            }
+            spxe.clock.frame = 1;
+        }
+
+        updated = 0;
+        while (spxeUpdate()) {
+            updated = 1;
+            if (!update(data, spxe.clock.step)) {
+                return 1;
+            }
+        }
+        
+        if (draw) {
+            draw(data, spxeAlpha());
+        }
+    }
+}
+
+/* defined with the trace timeline below */
+static void spxeTraceFree(void);
+
+int spxeEnd(Px* pixbuf)
+{
+    spxeHistoryStop();
+    spxeWorkersStop();
+    free(spxeScratch.data);
+    spxeScratch.data = NULL;
+    spxeScratch.size = 0;
+    spxeClose();
+    spxeTraceFree();
+    if (pixbuf) {
+        int i;
+        for (i = 0; i < spxe.buffers.count; ++i) {
+            spxeFree(spxe.buffers.list[i]);
+        }
+        spxe.buffers.count = 0;
+        spxeCanvasClose(spxe.canvas.data);
+        return EXIT_SUCCESS;
+    }
+
+    return EXIT_FAILURE;
+}
+
+/* image loading */
+
+struct spxeImage {
+    const unsigned char* data;
+    size_t size;
+    size_t offset;
+};
+
+struct spxeImageHeader {
+    int format;
+    int width;
+    int height;
+    unsigned long maxval;
+    size_t start;
+    size_t end;
+};
+
+#define SPXE_IMAGE_PPM_GRAY 5
+#define SPXE_IMAGE_PPM_RGB  6
+#define SPXE_IMAGE_QOI      'q'
+
+static const unsigned char* spxeMap(const char* path, size_t* size)
+{
+#ifdef SPXE_POSIX
+    void* data;
+    struct stat st;
+    const int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    *size = (size_t)st.st_size;
+    return (const unsigned char*)data;
+#else
+    long len;
+    unsigned char* data;
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = len > 0 ? (unsigned char*)malloc(len) : NULL;
+    if (data && fread(data, 1, len, file) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+    *size = (size_t)len;
+    return data;
+#endif
+}
+
+static void spxeUnmap(const unsigned char* data, const size_t size)
+{
+#ifdef SPXE_POSIX
+    munmap((void*)(size_t)data, size);
+#else
+    (void)size;
+    free((void*)(size_t)data);
+#endif
+}
+
+static size_t spxePpmNumber(
+    const unsigned char* data, const size_t size, size_t i, unsigned long* n)
+{
+    while (i < size) {
+        if (data[i] == '#') {
+            while (i < size && data[i] != '\n') {
+                ++i;
+            }
+        }
+        else if (data[i] == ' ' || (data[i] >= '\t' && data[i] <= '\r')) {
+            ++i;
+        }
+        else break;
+    }
+
+    if (i >= size || data[i] < '0' || data[i] > '9') {
+        return 0;
+    }
+
+    for (*n = 0; i < size && data[i] >= '0' && data[i] <= '9'; ++i) {
+        *n = *n * 10 + (data[i] - '0');
+        if (*n > 0x7fffffff) {
+            return 0;
+        }
+    }
+
+    return i;
+}
+
+static unsigned long spxeQoiU32(const unsigned char* p)
+{
+    return  ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) |
+            ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+
+static int spxeImageParse(const spxeImage* image, struct spxeImageHeader* h)
+{
+    unsigned long w = 0, ht = 0;
+    const unsigned char* data = image->data;
+    const size_t size = image->size;
+    size_t i = image->offset;
+
+    while (i < size && (data[i] == ' ' || (data[i] >= '\t' && data[i] <= '\r'))) {
+        ++i;
+    }
+    
+    if (i + 14 <= size && !memcmp(data + i, "qoif", 4)) {
+        w = spxeQoiU32(data + i + 4);
+        ht = spxeQoiU32(data + i + 8);
+        h->format = SPXE_IMAGE_QOI;
+        h->maxval = 255;
+        h->start = i + 14;
+        h->end = size;
+    }
+    else if (i + 2 < size && data[i] == 'P' && (data[i + 1] == '5' || data[i + 1] == '6')) {
+        size_t rowsize;
+        h->format = data[i + 1] - '0';
+        i = spxePpmNumber(data, size, i + 2, &w);
+        i = i ? spxePpmNumber(data, size, i, &ht) : 0;
+        i = i ? spxePpmNumber(data, size, i, &h->maxval) : 0;
+        if (!i || i >= size || !h->maxval || h->maxval > 65535 || !w || !ht) {
+            return 0;
+        }
+
+        rowsize = w * (h->format == SPXE_IMAGE_PPM_RGB ? 3 : 1) * (h->maxval > 255 ? 2 : 1);
+        h->start = i + 1;
+        if ((size - h->start) / rowsize < ht) {
+            return 0;
+        }
+        h->end = h->start + rowsize * ht;
+    }
+    else return 0;
+
+    if (!w || !ht || w > 0x7fff || ht > 0x7fff) {
+        return 0;
+    }
+
+    h->width = (int)w;
+    h->height = (int)ht;
+    return 1;
+}
+
+static size_t spxeImageDecodePpm(
+    const spxeImage* image, const struct spxeImageHeader* h,
+    Px* pixbuf, const int width, const int height, const int stride)
+{
+    int x, y;
+    const int channels = h->format == SPXE_IMAGE_PPM_RGB ? 3 : 1;
+    const int bytes = h->maxval > 255 ? 2 : 1;
+    const int w = h->width < width ? h->width : width;
+    const size_t rowsize = (size_t)h->width * channels * bytes;
+    const unsigned long maxval = h->maxval;
+
+    for (y = 0; y < h->height; ++y) {
+        const int dy = h->height - 1 - y;
+        const unsigned char* src = image->data + h->start + rowsize * y;
+        Px* dst = pixbuf + (size_t)dy * stride;
+        if (dy >= height) {
+            continue;
+        }
+
+        if (channels == 3 && bytes == 1 && maxval == 255) {
+            for (x = 0; x < w; ++x, src += 3) {
+                dst[x].r = src[0];
+                dst[x].g = src[1];
+                dst[x].b = src[2];
+                dst[x].a = 255;
+            }
+        }
+        else for (x = 0; x < w; ++x) {
+            unsigned long c[3];
+            int i;
+            for (i = 0; i < channels; ++i, src += bytes) {
+                c[i] = bytes == 2 ? ((unsigned long)src[0] << 8) | src[1] : src[0];
+                c[i] = c[i] * 255 / maxval;
+            }
+            dst[x].r = (unsigned char)c[0];
+            dst[x].g = (unsigned char)c[channels == 3 ? 1 : 0];
+            dst[x].b = (unsigned char)c[channels == 3 ? 2 : 0];
+            dst[x].a = 255;
+        }
+    }
+
+    return h->end;
+}
+
+static size_t spxeImageDecodeQoi(
+    const spxeImage* image, const struct spxeImageHeader* h,
+    Px* pixbuf, const int width, const int height, const int stride)
+{
+    Px index[64], px = {0, 0, 0, 255};
+    const unsigned char* data = image->data;
+    const size_t end = image->size - 8;
+    size_t p = h->start;
+    int x, y, run = 0;
+    
+    if (image->size < h->start + 8) {
+        return 0;
+    }
+
+    memset(index, 0, sizeof(index));
+    for (y = 0; y < h->height; ++y) {
+        const int dy = h->height - 1 - y;
+        Px* dst = dy < height ? pixbuf + (size_t)dy * stride : NULL;
+        for (x = 0; x < h->width; ++x) {
+            if (run > 0) {
+                --run;
+            }
+            else if (p < end) {
+                const int b = data[p++];
+                if (b == 0xfe) {
+                    px.r = data[p];
+                    px.g = data[p + 1];
+                    px.b = data[p + 2];
+                    p += 3;
+                }
+                else if (b == 0xff) {
+                    px.r = data[p];
+                    px.g = data[p + 1];
+                    px.b = data[p + 2];
+                    px.a = data[p + 3];
+                    p += 4;
+                }
+                else if ((b & 0xc0) == 0x00) {
+                    px = index[b];
+                }
+                else if ((b & 0xc0) == 0x40) {
+                    px.r += ((b >> 4) & 0x03) - 2;
+                    px.g += ((b >> 2) & 0x03) - 2;
+                    px.b += (b & 0x03) - 2;
+                }
+                else if ((b & 0xc0) == 0x80) {
+                    const int b2 = data[p++];
+                    const int vg = (b & 0x3f) - 32;
+                    px.r += vg - 8 + ((b2 >> 4) & 0x0f);
+                    px.g += vg;
+                    px.b += vg - 8 + (b2 & 0x0f);
+                }
+                else run = b & 0x3f;
+
+                index[(px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) & 63] = px;
+            }
+            else return 0;
+
+            if (dst && x < width) {
+                dst[x] = px;
+            }
+        }
+    }
+
+    return p + 8 <= image->size ? p + 8 : 0;
+}
+
+static int spxeImageDecode(
+    spxeImage* image, Px* pixbuf, const int width, const int height, const int stride)
+{
+    size_t end;
+    struct spxeImageHeader h;
+    if (!spxeImageParse(image, &h)) {
+        return 0;
+    }
+
+    if (h.format == SPXE_IMAGE_QOI) {
+        end = spxeImageDecodeQoi(image, &h, pixbuf, width, height, stride);
+    }
+    else end = spxeImageDecodePpm(image, &h, pixbuf, width, height, stride);
+    
+    if (!end) {
+        return 0;
+    }
+
+    image->offset = end;
+    return 1;
+}
+
+spxeImage* spxeImageOpen(const char* path)
+{
+    spxeImage* image;
+    size_t size = 0;
+    const unsigned char* data = spxeMap(path, &size);
+    if (!data) {
+        fprintf(stderr, "spxe failed to open image file '%s'.\n", path);
+        return NULL;
+    }
+
+    image = (spxeImage*)malloc(sizeof(spxeImage));
+    if (!image) {
+        spxeUnmap(data, size);
+        return NULL;
+    }
+
+    image->data = data;
+    image->size = size;
+    image->offset = 0;
+    return image;
+}
+
+void spxeImageClose(spxeImage* image)
+{
+    if (image) {
+        spxeUnmap(image->data, image->size);
+        free(image);
+    }
+}
+
+int spxeImageSize(spxeImage* image, int* width, int* height)
+{
+    struct spxeImageHeader h;
+    if (!spxeImageParse(image, &h)) {
+        return 0;
+    }
+
+    *width = h.width;
+    *height = h.height;
+    return 1;
+}
+
+int spxeImageNext(
+    spxeImage* image, Px* pixbuf, const int width, const int height, const int stride)
+{
+    return spxeImageDecode(image, pixbuf, width, height, stride);
+}
+
+int spxeImageRead(
+    const char* path, Px* pixbuf, const int width, const int height, const int stride)
+{
+    int ret;
+    spxeImage* image = spxeImageOpen(path);
+    if (!image) {
+        return 0;
+    }
+
+    ret = spxeImageDecode(image, pixbuf, width, height, stride);
+    spxeImageClose(image);
+    return ret;
+}
+
+Px* spxeImageLoad(const char* path, int* width, int* height)
+{
+    Px* pixbuf = NULL;
+    spxeImage* image = spxeImageOpen(path);
+    if (!image) {
+        return NULL;
+    }
+
+    if (spxeImageSize(image, width, height)) {
+        pixbuf = (Px*)malloc((size_t)*width * *height * sizeof(Px));
+        if (pixbuf && !spxeImageDecode(image, pixbuf, *width, *height, *width)) {
+            free(pixbuf);
+            pixbuf = NULL;
+        }
+    }
+
+    if (!pixbuf) {
+        fprintf(stderr, "spxe failed to decode image file '%s'.\n", path);
+    }
+
+    spxeImageClose(image);
+    return pixbuf;
+}
+
+/* chrome trace event timeline */
+
+#ifdef SPXE_TRACE
+
+#ifndef SPXE_TRACE_EVENTS
+    #define SPXE_TRACE_EVENTS 16384
+#endif
+
+#ifndef SPXE_TRACE_DEPTH
+    #define SPXE_TRACE_DEPTH 32
+#endif
+
+#if defined(_MSC_VER)
+    #define SPXE_THREAD __declspec(thread)
+#else
+    #define SPXE_THREAD __thread
+#endif
+
+#ifdef SPXE_POSIX
+    #include <time.h>
+#endif
+
+struct spxeTraceEvent {
+    const char* name;
+    double start;
+    double duration;
+};
+
+/* written only by its own thread, the newest SPXE_TRACE_EVENTS are kept */
+struct spxeTraceRing {
+    struct spxeTraceRing* next;
+    volatile unsigned long count;
+    int tid;
+    int depth;
+    const char* names[SPXE_TRACE_DEPTH];
+    double starts[SPXE_TRACE_DEPTH];
+    struct spxeTraceEvent events[SPXE_TRACE_EVENTS];
+};
+
+/* rings of an older generation were freed, their threads start new ones */
+static struct spxeTraceRing* volatile spxeTraceRings;
+static volatile unsigned long spxeTraceGeneration;
+static SPXE_THREAD struct spxeTraceRing* spxeTraceLocal;
+static SPXE_THREAD unsigned long spxeTraceLocalGeneration;
+
+/* microseconds, the chrome trace timestamp unit */
+static double spxeTraceClock(void)
+{
+#ifdef SPXE_POSIX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec * 1e-3;
+#else
+    return spxeClock() * 1e6;
+#endif
+}
+
+static struct spxeTraceRing* spxeTraceThread(void)
+{
+    static volatile int threads;
+    struct spxeTraceRing* ring = (struct spxeTraceRing*)malloc(sizeof(struct spxeTraceRing));
+    if (!ring) {
+        return NULL;
+    }
+
+    ring->count = 0;
+    ring->depth = 0;
+#if defined(__GNUC__) || defined(__clang__)
+    ring->tid = __sync_add_and_fetch(&threads, 1);
+    do {
+        ring->next = spxeTraceRings;
+    } while (!__sync_bool_compare_and_swap(&spxeTraceRings, ring->next, ring));
+#else
+    ring->tid = ++threads;
+    ring->next = spxeTraceRings;
+    spxeTraceRings = ring;
+#endif
+    return ring;
+}
+
+void spxeTraceBegin(const char* name)
+{
+    struct spxeTraceRing* ring = spxeTraceLocal;
+    if (!ring || spxeTraceLocalGeneration != spxeTraceGeneration) {
+        spxeTraceLocalGeneration = spxeTraceGeneration;
+        ring = spxeTraceLocal = spxeTraceThread();
+        if (!ring) {
+            return;
+        }
+    }
+
+    if (ring->depth < SPXE_TRACE_DEPTH) {
+        ring->names[ring->depth] = name;
+        ring->starts[ring->depth] = spxeTraceClock();
+    }
+    ++ring->depth;
+}
+
+void spxeTraceEnd(void)
+{
+    struct spxeTraceRing* ring = spxeTraceLocal;
+    if (!ring || spxeTraceLocalGeneration != spxeTraceGeneration || !ring->depth) {
+        return;
+    }
+
+    if (--ring->depth < SPXE_TRACE_DEPTH) {
+        struct spxeTraceEvent* event = ring->events + ring->count % SPXE_TRACE_EVENTS;
+        event->name = ring->names[ring->depth];
+        event->start = ring->starts[ring->depth];
+        event->duration = spxeTraceClock() - event->start;
+        SPXE_BARRIER();
+        ring->count = ring->count + 1;
+    }
+}
+
+static void spxeTraceString(FILE* file, const char* str)
+{
+    fputc('"', file);
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', file);
+            fputc(*str, file);
+        }
+        else if ((unsigned char)*str < 32) {
+            fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*str);
+        }
+        else fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+int spxeTraceDump(const char* path)
+{
+    const char* sep = "";
+    struct spxeTraceRing* ring;
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "spxe failed to open trace file '%s'.\n", path);
+        return 0;
+    }
+
+    fprintf(file, "{\"traceEvents\":[");
+    for (ring = spxeTraceRings; ring; ring = ring->next) {
+        const unsigned long count = ring->count;
+        unsigned long i = count > SPXE_TRACE_EVENTS ? count - SPXE_TRACE_EVENTS : 0;
+        fprintf(file,
+            "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"spxe thread %d\"}}", sep, ring->tid, ring->tid
+        );
+        sep = ",";
+        for (; i < count; ++i) {
+            const struct spxeTraceEvent* event = ring->events + i % SPXE_TRACE_EVENTS;
+            fprintf(file, ",\n{\"name\":");
+            spxeTraceString(file, event->name);
+            fprintf(file,
+                ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                event->start, event->duration, ring->tid
+            );
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    if (fclose(file)) {
+        fprintf(stderr, "spxe failed to write trace file '%s'.\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/* called by spxeEnd() once its own threads are stopped */
+static void spxeTraceFree(void)
+{
+    struct spxeTraceRing* ring = spxeTraceRings;
+    spxeTraceRings = NULL;
+    spxeTraceLocal = NULL;
+    spxeTraceGeneration = spxeTraceGeneration + 1;
+    while (ring) {
+        struct spxeTraceRing* next = ring->next;
+        free(ring);
+        ring = next;
+    }
+}
+
+#else /* !SPXE_TRACE */
+
+static void spxeTraceFree(void)
+{
+}
+
+void spxeTraceBegin(const char* name)
+{
+    (void)name;
+}
+
+void spxeTraceEnd(void)
+{
+}
+
+int spxeTraceDump(const char* path)
+{
+    (void)path;
+    return 0;
+}
+
+#endif /* SPXE_TRACE */
+
+#endif /* SPXE_APPLICATION */
+
+/* shared memory frames, also built alone with SPXE_PRODUCER */
+
+#if defined(SPXE_APPLICATION) || defined(SPXE_PRODUCER)
+
+#define SPXE_SHARED_MAGIC 0x32585053U
+#define SPXE_SHARED_HEADER 64
+
+/* lives at the start of the shared memory object, frames follow it. Every
+field is 32 bits wide so 32 and 64 bit processes can share the same ring */
+struct spxeSharedHeader {
+    unsigned int magic;
+    unsigned int width, height, count;
+    unsigned int sequence;
+};
+
+typedef char spxeSharedInt[sizeof(unsigned int) == 4 ? 1 : -1];
+
+/* the sequence is published with release and read with acquire ordering,
+so a frame is complete in memory before its sequence number can be seen */
+static unsigned int spxeSharedLoad(const unsigned int* ptr)
+{
+#if defined(__ATOMIC_ACQUIRE)
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#else
+    const unsigned int val = *(const volatile unsigned int*)ptr;
+    SPXE_BARRIER();
+    return val;
+#endif
+}
+
+static void spxeSharedStore(unsigned int* ptr, const unsigned int val)
+{
+#if defined(__ATOMIC_RELEASE)
+    __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+#else
+    SPXE_BARRIER();
+    *(volatile unsigned int*)ptr = val;
+#endif
+}
+
+struct spxeShared {
+    struct spxeSharedHeader* header;
+    Px* frames;
+    size_t size;
+    int owner;
+    char name[256];
+};
+
+#ifdef SPXE_POSIX
+
+static size_t spxeSharedBytes(const int width, const int height, const int count)
+{
+    return SPXE_SHARED_HEADER + (size_t)width * height * count * sizeof(Px);
+}
+
+/* shared memory object names start with a single slash */
+static const char* spxeSharedName(const char* name, char* buf, const size_t size)
+{
+    buf[0] = '/';
+    strncpy(buf + 1, name + (name[0] == '/'), size - 2);
+    buf[size - 1] = 0;
+    return buf;
+}
+
+static spxeShared* spxeSharedMap(const char* name, const int fd, const size_t size)
+{
+    spxeShared* shared;
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    shared = (spxeShared*)malloc(sizeof(spxeShared));
+    if (!shared) {
+        munmap(data, size);
+        return NULL;
+    }
+
+    shared->header = (struct spxeSharedHeader*)data;
+    shared->frames = (Px*)((unsigned char*)data + SPXE_SHARED_HEADER);
+    shared->size = size;
+    shared->owner = 0;
+    spxeSharedName(name, shared->name, sizeof(shared->name));
+    return shared;
+}
+
+spxeShared* spxeSharedCreate(const char* name, const int width, const int height, const int count)
+{
+    int fd;
+    char path[256];
+    struct stat st;
+    spxeShared* shared;
+    struct spxeSharedHeader* header;
+    const size_t size = spxeSharedBytes(width, height, count);
+
+    if (width <= 0 || height <= 0 || count < 2) {
+        fprintf(stderr, "spxe failed to create shared frames '%s', invalid size.\n", name);
+        return NULL;
+    }
+
+    /* a ring left by a previous run is reused when it has the same layout,
+    so a restarted producer keeps feeding viewers that still have it mapped */
+    spxeSharedName(name, path, sizeof(path));
+    fd = shm_open(path, O_RDWR | O_CREAT, 0600);
+    if (fd != -1 && !fstat(fd, &st) && st.st_size && (size_t)st.st_size != size) {
+        close(fd);
+        shm_unlink(path);
+        fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+
+    if (fd == -1 || ftruncate(fd, (off_t)size)) {
+        fprintf(stderr, "spxe failed to create shared frames '%s'.\n", name);
+        if (fd != -1) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    shared = spxeSharedMap(name, fd, size);
+    if (!shared) {
+        fprintf(stderr, "spxe failed to map shared frames '%s'.\n", name);
+        shm_unlink(path);
+        return NULL;
+    }
+
+    header = shared->header;
+    if (header->magic != SPXE_SHARED_MAGIC || header->width != (unsigned)width ||
+        header->height != (unsigned)height || header->count != (unsigned)count) {
+        spxeSharedStore(&header->magic, 0);
+        header->width = (unsigned)width;
+        header->height = (unsigned)height;
+        header->count = (unsigned)count;
+        header->sequence = 0;
+        spxeSharedStore(&header->magic, SPXE_SHARED_MAGIC);
+    }
+
+    shared->owner = 1;
+    return shared;
+}
+
+spxeShared* spxeSharedOpen(const char* name)
+{
+    char path[256];
+    struct stat st;
+    spxeShared* shared;
+    const int fd = shm_open(spxeSharedName(name, path, sizeof(path)), O_RDWR, 0);
+    if (fd == -1 || fstat(fd, &st) || (size_t)st.st_size < SPXE_SHARED_HEADER) {
+        fprintf(stderr, "spxe failed to open shared frames '%s'.\n", name);
+        if (fd != -1) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    shared = spxeSharedMap(name, fd, (size_t)st.st_size);
+    if (!shared) {
+        fprintf(stderr, "spxe failed to map shared frames '%s'.\n", name);
+        return NULL;
+    }
+
+    if (spxeSharedLoad(&shared->header->magic) != SPXE_SHARED_MAGIC ||
+        shared->header->count < 2 ||
+        spxeSharedBytes(shared->header->width, shared->header->height,
+                        shared->header->count) > shared->size) {
+        fprintf(stderr, "spxe found invalid shared frames in '%s'.\n", name);
+        spxeSharedClose(shared);
+        return NULL;
+    }
+
+    return shared;
+}
+
+void spxeSharedClose(spxeShared* shared)
+{
+    if (shared) {
+        if (shared->owner) {
+            shm_unlink(shared->name);
+        }
+        munmap(shared->header, shared->size);
+        free(shared);
+    }
+}
+
+#else /* !SPXE_POSIX */
+
+spxeShared* spxeSharedCreate(const char* name, const int width, const int height, const int count)
+{
+    (void)width;
+    (void)height;
+    (void)count;
+    fprintf(stderr, "spxe shared frames '%s' are not supported on this platform.\n", name);
+    return NULL;
+}
+
+spxeShared* spxeSharedOpen(const char* name)
+{
+    fprintf(stderr, "spxe shared frames '%s' are not supported on this platform.\n", name);
+    return NULL;
+}
+
+void spxeSharedClose(spxeShared* shared)
+{
+    (void)shared;
+}
+
+#endif /* SPXE_POSIX */
+
+int spxeSharedSize(spxeShared* shared, int* width, int* height)
+{
+    if (!shared) {
+        return 0;
+    }
+
+    *width = (int)shared->header->width;
+    *height = (int)shared->header->height;
+    return 1;
+}
+
+/* sequences wrap from the largest multiple of count back to count, so they
+are never zero and their slots keep following each other across the wrap */
+static unsigned int spxeSharedWrap(const struct spxeSharedHeader* header)
+{
+    return 0xFFFFFFFFU - 0xFFFFFFFFU % header->count;
+}
+
+static unsigned int spxeSharedNext(const struct spxeSharedHeader* header, const unsigned int seq)
+{
+    return seq + 1 < spxeSharedWrap(header) ? seq + 1 : header->count;
+}
+
+/* frames published after older up to newer */
+static unsigned int spxeSharedDistance(
+    const struct spxeSharedHeader* header, const unsigned int newer, const unsigned int older)
+{
+    return newer >= older ? newer - older : spxeSharedWrap(header) - older + newer - header->count;
+}
+
+/* the producer writes one slot ahead of the last published frame */
+Px* spxeSharedBuffer(spxeShared* shared)
+{
+    const struct spxeSharedHeader* header = shared->header;
+    const unsigned int slot = spxeSharedNext(header, header->sequence) % header->count;
+    return shared->frames + (size_t)slot * header->width * header->height;
+}
+
+unsigned long spxeSharedPublish(spxeShared* shared)
+{
+    const unsigned int sequence = spxeSharedNext(shared->header, shared->header->sequence);
+    spxeSharedStore(&shared->header->sequence, sequence);
+    /* like a seqlock writer, the new sequence must be visible before any write
+    to the next slot, which the release store alone does not order */
+    SPXE_BARRIER();
+    return sequence;
+}
+
+const Px* spxeSharedFrame(spxeShared* shared, unsigned long* seqptr)
+{
+    const struct spxeSharedHeader* header = shared->header;
+    const unsigned int sequence = spxeSharedLoad(&header->sequence);
+
+    if (seqptr) {
+        *seqptr = sequence;
+    }
+
+    if (!sequence) {
+        return NULL;
+    }
+
+    return shared->frames + (size_t)(sequence % header->count) * header->width * header->height;
+}
+
+/* the producer starts overwriting a frame right after publishing the one
+count - 1 frames ahead of it, like the second read of a seqlock */
+int spxeSharedValid(spxeShared* shared, const unsigned long seq)
+{
+    const struct spxeSharedHeader* header = shared->header;
+    unsigned int sequence;
+    SPXE_BARRIER();
+    sequence = spxeSharedLoad(&header->sequence);
+    return seq && spxeSharedDistance(header, sequence, (unsigned int)seq) <= header->count - 2;
+}
+
+int spxeSharedCopy(spxeShared* shared, Px* pixbuf, unsigned long* seqptr)
+{
+    const struct spxeSharedHeader* header = shared->header;
+    const size_t size = (size_t)header->width * header->height * sizeof(Px);
+    unsigned long sequence;
+    const Px* frame;
+
+    do {
+        frame = spxeSharedFrame(shared, &sequence);
+        if (!frame) {
+            return 0;
+        }
+        memcpy(pixbuf, frame, size);
+    } while (!spxeSharedValid(shared, sequence));
+
+    if (seqptr) {
+        *seqptr = sequence;
+    }
+    return 1;
+}
+
+#endif /* SPXE_APPLICATION || SPXE_PRODUCER */
+
+/* frame streams over sockets, also built alone with SPXE_PRODUCER */
+
+#if defined(SPXE_APPLICATION) || defined(SPXE_PRODUCER)
+
+#define SPXE_STREAM_MAGIC 0x73657073UL
+#define SPXE_STREAM_HEADER 16
+#define SPXE_STREAM_TILE 32
+#define SPXE_STREAM_CLIENTS 16
+/* unchanged runs shorter than this are sent as literals, which bounds the encoded size */
+#define SPXE_STREAM_RUN 4
+#define SPXE_STREAM_KEY 1
+
+struct spxeStreamClient {
+    int fd;
+    int synced;
+    unsigned char* pending;
+    size_t size;
+    size_t sent;
+};
+
+struct spxeStream {
+    int fd;
+    int width;
+    int height;
+    int tile;
+    unsigned long sequence;
+    /* last frame sent by the server or received by the viewer */
+    Px* frame;
+    /* server side */
+    struct spxeStreamClient clients[SPXE_STREAM_CLIENTS];
+    unsigned char* messages[2];
+    unsigned int* words;
+    /* viewer side */
+    unsigned char* input;
+    size_t used;
+    size_t capacity;
+    char path[108];
+};
+
+#ifdef SPXE_POSIX
+
+#include <errno.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#ifdef MSG_NOSIGNAL
+    #define SPXE_STREAM_SEND MSG_NOSIGNAL
+#else
+    #define SPXE_STREAM_SEND 0
+#endif
+
+static void spxeStreamPut(unsigned char* p, const unsigned long n)
+{
+    p[0] = (unsigned char)(n & 0xff);
+    p[1] = (unsigned char)((n >> 8) & 0xff);
+    p[2] = (unsigned char)((n >> 16) & 0xff);
+    p[3] = (unsigned char)((n >> 24) & 0xff);
+}
+
+static unsigned long spxeStreamGet(const unsigned char* p)
+{
+    return  (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+            ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* largest encoded tile, literals plus two varints per token */
+static size_t spxeStreamTileBytes(const int tile)
+{
+    const size_t n = (size_t)tile * tile;
+    return 8 + n * sizeof(Px) + (n / SPXE_STREAM_RUN + 2) * 6;
+}
+
+/* largest message, a keyframe with every tile */
+static size_t spxeStreamMessageBytes(const spxeStream* stream)
+{
+    const size_t tiles = (size_t)((stream->width + stream->tile - 1) / stream->tile) *
+        ((stream->height + stream->tile - 1) / stream->tile);
+    return 12 + tiles * spxeStreamTileBytes(stream->tile);
+}
+
+static unsigned char* spxeStreamVarint(unsigned char* out, unsigned long n)
+{
+    while (n >= 128) {
+        *out++ = (unsigned char)(n | 128);
+        n >>= 7;
+    }
+    *out++ = (unsigned char)n;
+    return out;
+}
+
+static const unsigned char* spxeStreamVarintRead(
+    const unsigned char* in, const unsigned char* end, unsigned long* n)
+{
+    int shift = 0;
+    *n = 0;
+    while (in < end && shift < 32) {
+        *n |= (unsigned long)(*in & 127) << shift;
+        shift += 7;
+        if (!(*in++ & 128)) {
+            return in;
+        }
+    }
+    return NULL;
+}
+
+/* runs of pixels equal to a reference and literal pixels, the reference being the
+previous frame for deltas and the pixel before in the tile for keyframes */
+static unsigned char* spxeStreamEncode(
+    unsigned char* out, const unsigned int* words, const unsigned int* ref, const size_t n)
+{
+    size_t i = 0;
+    while (i < n) {
+        size_t same = i, literals;
+        while (i < n && words[i] == ref[i]) {
+            ++i;
+        }
+        same = i - same;
+
+        literals = i;
+        while (i < n) {
+            size_t run = i;
+            while (run < n && run - i < SPXE_STREAM_RUN && words[run] == ref[run]) {
+                ++run;
+            }
+            if (run - i >= SPXE_STREAM_RUN || run == n) {
+                break;
+            }
+            i = run + 1;
+        }
+        literals = i - literals;
+
+        out = spxeStreamVarint(out, (unsigned long)same);
+        out = spxeStreamVarint(out, (unsigned long)literals);
+        memcpy(out, words + i - literals, literals * sizeof(unsigned int));
+        out += literals * sizeof(unsigned int);
+    }
+    return out;
+}
+
+/* appends one tile to both messages, the delta only when the tile changed */
+static void spxeStreamTile(
+    spxeStream* stream, const Px* pixbuf, const int stride, const int index,
+    unsigned char** delta, unsigned char** key)
+{
+    int y, changed = 0;
+    size_t i;
+    const int columns = (stream->width + stream->tile - 1) / stream->tile;
+    const int x0 = index % columns * stream->tile, y0 = index / columns * stream->tile;
+    const int w = stream->width - x0 < stream->tile ? stream->width - x0 : stream->tile;
+    const int h = stream->height - y0 < stream->tile ? stream->height - y0 : stream->tile;
+    const size_t n = (size_t)w * h;
+    unsigned int* words = stream->words;
+    unsigned int* ref = stream->words + (size_t)stream->tile * stream->tile;
+
+    for (y = 0; y < h && !changed; ++y) {
+        changed = memcmp(
+            pixbuf + (size_t)(y0 + y) * stride + x0,
+            stream->frame + (size_t)(y0 + y) * stream->width + x0, w * sizeof(Px)
+        );
+    }
+    if (!changed && !*key) {
+        return;
+    }
+
+    for (y = 0; y < h; ++y) {
+        const Px* src = pixbuf + (size_t)(y0 + y) * stride + x0;
+        Px* prev = stream->frame + (size_t)(y0 + y) * stream->width + x0;
+        memcpy(words + (size_t)y * w, src, w * sizeof(Px));
+        memcpy(ref + (size_t)y * w, prev, w * sizeof(Px));
+        memcpy(prev, src, w * sizeof(Px));
+    }
+
+    if (changed) {
+        unsigned char* start = *delta;
+        *delta = spxeStreamEncode(start + 8, words, ref, n);
+        spxeStreamPut(start, (unsigned long)index);
+        spxeStreamPut(start + 4, (unsigned long)(*delta - start - 8));
+    }
+
+    if (*key) {
+        unsigned char* start = *key;
+        ref[0] = 0;
+        for (i = 1; i < n; ++i) {
+            ref[i] = words[i - 1];
+        }
+        *key = spxeStreamEncode(start + 8, words, ref, n);
+        spxeStreamPut(start, (unsigned long)index);
+        spxeStreamPut(start + 4, (unsigned long)(*key - start - 8));
+    }
+}
+
+/* decodes one tile into the frame, returns zero when it doesn't fit */
+static int spxeStreamDecode(
+    spxeStream* stream, const unsigned long index, const int key,
+    const unsigned char* in, const unsigned char* end)
+{
+    unsigned long same, literals;
+    int x0, y0, w, h;
+    size_t i = 0, n;
+    Px* origin;
+    Px previous = {0, 0, 0, 0};
+    const int columns = (stream->width + stream->tile - 1) / stream->tile;
+    const int rows = (stream->height + stream->tile - 1) / stream->tile;
+    if (index >= (unsigned long)columns * rows) {
+        return 0;
+    }
+
+    x0 = (int)(index % columns) * stream->tile;
+    y0 = (int)(index / columns) * stream->tile;
+    w = stream->width - x0 < stream->tile ? stream->width - x0 : stream->tile;
+    h = stream->height - y0 < stream->tile ? stream->height - y0 : stream->tile;
+    n = (size_t)w * h;
+    origin = stream->frame + (size_t)y0 * stream->width + x0;
+
+    while (in < end) {
+        in = spxeStreamVarintRead(in, end, &same);
+        in = in ? spxeStreamVarintRead(in, end, &literals) : NULL;
+        if (!in || same > n - i || literals > n - i - same ||
+            literals * sizeof(Px) > (size_t)(end - in)) {
+            return 0;
+        }
+
+        for (; same; --same, ++i) {
+            Px* p = origin + i / w * stream->width + i % w;
+            if (key) {
+                *p = previous;
+            }
+            previous = *p;
+        }
+        for (; literals; --literals, ++i, in += sizeof(Px)) {
+            Px* p = origin + i / w * stream->width + i % w;
+            memcpy(p, in, sizeof(Px));
+            previous = *p;
+        }
+    }
+
+    return i == n;
+}
+
+static int spxeStreamApply(spxeStream* stream, const unsigned char* message, const size_t size)
+{
+    const unsigned char* end = message + size;
+    const int key = spxeStreamGet(message + 4) & SPXE_STREAM_KEY;
+    message += 12;
+
+    while (message < end) {
+        unsigned long index, bytes;
+        if (end - message < 8) {
+            return 0;
+        }
+        index = spxeStreamGet(message);
+        bytes = spxeStreamGet(message + 4);
+        message += 8;
+        if (bytes > (unsigned long)(end - message) ||
+            !spxeStreamDecode(stream, index, key, message, message + bytes)) {
+            return 0;
+        }
+        message += bytes;
+    }
+
+    return 1;
+}
+
+/* host:port and :port are TCP addresses, anything else a Unix socket path */
+static int spxeStreamSocket(const char* address, const int server, char* path)
+{
+    int fd = -1;
+    const char* port = strrchr(address, ':');
+    if (port && !strchr(address, '/') && port[1] &&
+        strspn(port + 1, "0123456789") == strlen(port + 1)) {
+        char host[256];
+        struct addrinfo hints, *list, *info;
+        const size_t len = (size_t)(port - address) < sizeof(host) ?
+            (size_t)(port - address) : sizeof(host) - 1;
+        memcpy(host, address, len);
+        host[len] = 0;
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = server ? AI_PASSIVE : 0;
+        if (getaddrinfo(len ? host : NULL, port + 1, &hints, &list)) {
+            return -1;
+        }
+
+        for (info = list; info && fd == -1; info = info->ai_next) {
+            const int one = 1;
+            fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+            if (fd == -1) {
+                continue;
+            }
+            if (server) {
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            }
+            else setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (server ? bind(fd, info->ai_addr, info->ai_addrlen) || listen(fd, 8) :
+                connect(fd, info->ai_addr, info->ai_addrlen)) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(list);
+    }
+    else {
+        struct sockaddr_un addr;
+        if (strlen(address) >= sizeof(addr.sun_path)) {
+            return -1;
+        }
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, address);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1) {
+            return -1;
+        }
+
+        /* a socket file left by a previous run is replaced, anything else is kept */
+        if (server) {
+            struct stat st;
+            if (!lstat(address, &st)) {
+                if (!S_ISSOCK(st.st_mode)) {
+                    close(fd);
+                    errno = EADDRINUSE;
+                    return -1;
+                }
+                unlink(address);
+            }
+        }
+        if (server ? bind(fd, (struct sockaddr*)&addr, sizeof(addr)) || listen(fd, 8) :
+            connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+            close(fd);
+            return -1;
+        }
+        if (server) {
+            strcpy(path, address);
+        }
+    }
+
+    return fd;
+}
+
+static void spxeStreamDrop(struct spxeStreamClient* client)
+{
+    close(client->fd);
+    free(client->pending);
+    memset(client, 0, sizeof(struct spxeStreamClient));
+    client->fd = -1;
+}
+
+/* sends without blocking, what doesn't fit in the socket is kept for later */
+static int spxeStreamSend(struct spxeStreamClient* client, const unsigned char* data, size_t size)
+{
+    while (size) {
+        const ssize_t n = send(client->fd, data, size, SPXE_STREAM_SEND);
+        if (n > 0) {
+            data += n;
+            size -= (size_t)n;
+        }
+        else if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        else return 0;
+    }
+
+    if (size) {
+        client->pending = (unsigned char*)malloc(size);
+        if (!client->pending) {
+            return 0;
+        }
+        memcpy(client->pending, data, size);
+        client->size = size;
+        client->sent = 0;
+    }
+    return 1;
+}
+
+static int spxeStreamFlush(struct spxeStreamClient* client)
+{
+    while (client->sent < client->size) {
+        const ssize_t n = send(
+            client->fd, client->pending + client->sent,
+            client->size - client->sent, SPXE_STREAM_SEND
+        );
+        if (n > 0) {
+            client->sent += (size_t)n;
+        }
+        else if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        else return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    free(client->pending);
+    client->pending = NULL;
+    client->size = 0;
+    client->sent = 0;
+    return 1;
+}
+
+static void spxeStreamAccept(spxeStream* stream)
+{
+    int fd, i;
+    unsigned char header[SPXE_STREAM_HEADER];
+    while ((fd = accept(stream->fd, NULL, NULL)) != -1) {
+        const int one = 1;
+        for (i = 0; i < SPXE_STREAM_CLIENTS && stream->clients[i].fd != -1; ++i);
+        if (i == SPXE_STREAM_CLIENTS) {
+            close(fd);
+            continue;
+        }
+
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        stream->clients[i].fd = fd;
+        spxeStreamPut(header, SPXE_STREAM_MAGIC);
+        spxeStreamPut(header + 4, (unsigned long)stream->width);
+        spxeStreamPut(header + 8, (unsigned long)stream->height);
+        spxeStreamPut(header + 12, (unsigned long)stream->tile);
+        if (!spxeStreamSend(stream->clients + i, header, sizeof(header))) {
+            spxeStreamDrop(stream->clients + i);
+        }
+    }
+}
+
+static spxeStream* spxeStreamAlloc(void)
+{
+    int i;
+    spxeStream* stream = (spxeStream*)calloc(1, sizeof(spxeStream));
+    if (stream) {
+        stream->fd = -1;
+        for (i = 0; i < SPXE_STREAM_CLIENTS; ++i) {
+            stream->clients[i].fd = -1;
+        }
+    }
+    return stream;
+}
+
+spxeStream* spxeStreamCreate(const char* address, const int width, const int height)
+{
+    spxeStream* stream;
+    if (width <= 0 || height <= 0 || width > 0x7fff || height > 0x7fff) {
+        fprintf(stderr, "spxe failed to create stream '%s', invalid size.\n", address);
+        return NULL;
+    }
+
+    stream = spxeStreamAlloc();
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->width = width;
+    stream->height = height;
+    stream->tile = SPXE_STREAM_TILE;
+    stream->frame = (Px*)calloc((size_t)width * height, sizeof(Px));
+    stream->messages[0] = (unsigned char*)malloc(spxeStreamMessageBytes(stream));
+    stream->messages[1] = (unsigned char*)malloc(spxeStreamMessageBytes(stream));
+    stream->words = (unsigned int*)malloc(
+        2 * SPXE_STREAM_TILE * SPXE_STREAM_TILE * sizeof(unsigned int)
+    );
+    stream->fd = spxeStreamSocket(address, 1, stream->path);
+    if (stream->fd == -1 || !stream->frame || !stream->messages[0] ||
+        !stream->messages[1] || !stream->words) {
+        fprintf(stderr, "spxe failed to create stream '%s'.\n", address);
+        spxeStreamClose(stream);
+        return NULL;
+    }
+
+    fcntl(stream->fd, F_SETFL, fcntl(stream->fd, F_GETFL) | O_NONBLOCK);
+    return stream;
+}
+
+/* sends the changed tiles to every viewer that got the previous frame, a viewer
+still busy with an older one skips this frame and gets a keyframe once it is done */
+unsigned long spxeStreamPublish(spxeStream* stream, const Px* pixbuf, const int stride)
+{
+    int i, needkey = 0, needdelta = 0;
+    const int tiles = ((stream->width + stream->tile - 1) / stream->tile) *
+        ((stream->height + stream->tile - 1) / stream->tile);
+    unsigned char* delta = stream->messages[0] + 12;
+    unsigned char* key = NULL;
+
+    spxeStreamAccept(stream);
+    for (i = 0; i < SPXE_STREAM_CLIENTS; ++i) {
+        struct spxeStreamClient* client = stream->clients + i;
+        if (client->fd != -1 && !spxeStreamFlush(client)) {
+            spxeStreamDrop(client);
+        }
+        needkey |= client->fd != -1 && !client->size && !client->synced;
+        needdelta |= client->fd != -1 && !client->size && client->synced;
+    }
+
+    /* without viewers nothing is encoded, the next one starts from a keyframe */
+    key = needkey ? stream->messages[1] + 12 : NULL;
+    for (i = 0; i < tiles && (needkey || needdelta); ++i) {
+        spxeStreamTile(stream, pixbuf, stride, i, &delta, &key);
+    }
+
+    ++stream->sequence;
+    spxeStreamPut(stream->messages[0], (unsigned long)(delta - stream->messages[0] - 4));
+    spxeStreamPut(stream->messages[0] + 4, 0);
+    spxeStreamPut(stream->messages[0] + 8, stream->sequence);
+    if (key) {
+        spxeStreamPut(stream->messages[1], (unsigned long)(key - stream->messages[1] - 4));
+        spxeStreamPut(stream->messages[1] + 4, SPXE_STREAM_KEY);
+        spxeStreamPut(stream->messages[1] + 8, stream->sequence);
+    }
+
+    for (i = 0; i < SPXE_STREAM_CLIENTS; ++i) {
+        struct spxeStreamClient* client = stream->clients + i;
+        const unsigned char* message = stream->messages[client->synced ? 0 : 1];
+        const unsigned char* end = client->synced ? delta : key;
+        if (client->fd == -1) {
+            continue;
+        }
+        if (client->size) {
+            client->synced = 0;
+        }
+        else if (!spxeStreamSend(client, message, (size_t)(end - message))) {
+            spxeStreamDrop(client);
+        }
+        else client->synced = 1;
+    }
+
+    return stream->sequence;
+}
+
+spxeStream* spxeStreamOpen(const char* address)
+{
+    size_t got = 0;
+    unsigned char header[SPXE_STREAM_HEADER];
+    spxeStream* stream = spxeStreamAlloc();
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->fd = spxeStreamSocket(address, 0, stream->path);
+    if (stream->fd == -1) {
+        fprintf(stderr, "spxe failed to connect to stream '%s'.\n", address);
+        free(stream);
+        return NULL;
+    }
+
+    while (got < sizeof(header)) {
+        const ssize_t n = recv(stream->fd, header + got, sizeof(header) - got, 0);
+        if (n <= 0 && !(n < 0 && errno == EINTR)) {
+            break;
+        }
+        got += n > 0 ? (size_t)n : 0;
+    }
+
+    stream->width = (int)spxeStreamGet(header + 4);
+    stream->height = (int)spxeStreamGet(header + 8);
+    stream->tile = (int)spxeStreamGet(header + 12);
+    if (got < sizeof(header) || spxeStreamGet(header) != SPXE_STREAM_MAGIC ||
+        stream->width <= 0 || stream->height <= 0 || stream->width > 0x7fff ||
+        stream->height > 0x7fff || stream->tile <= 0 || stream->tile > 256) {
+        fprintf(stderr, "spxe found an invalid stream at '%s'.\n", address);
+        spxeStreamClose(stream);
+        return NULL;
+    }
+
+    stream->capacity = spxeStreamMessageBytes(stream);
+    stream->input = (unsigned char*)malloc(stream->capacity);
+    stream->frame = (Px*)calloc((size_t)stream->width * stream->height, sizeof(Px));
+    if (!stream->input || !stream->frame) {
+        spxeStreamClose(stream);
+        return NULL;
+    }
+
+    fcntl(stream->fd, F_SETFL, fcntl(stream->fd, F_GETFL) | O_NONBLOCK);
+    return stream;
+}
+
+/* reads whatever arrived and applies every complete message */
+static int spxeStreamReceive(spxeStream* stream)
+{
+    size_t offset = 0;
+    while (1) {
+        const ssize_t n = recv(
+            stream->fd, stream->input + stream->used, stream->capacity - stream->used, 0
+        );
+        if (n > 0) {
+            stream->used += (size_t)n;
+        }
+        else if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (!n || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            return 0;
+        }
+
+        while (stream->used - offset >= 12) {
+            const unsigned char* message = stream->input + offset;
+            const size_t size = spxeStreamGet(message) + 4;
+            if (size < 12 || size > stream->capacity) {
+                return 0;
+            }
+            if (stream->used - offset < size) {
+                break;
+            }
+            if (!spxeStreamApply(stream, message, size)) {
+                return 0;
+            }
+            stream->sequence = spxeStreamGet(message + 8);
+            offset += size;
+        }
+
+        memmove(stream->input, stream->input + offset, stream->used - offset);
+        stream->used -= offset;
+        offset = 0;
+        if (n < 0) {
+            return 1;
+        }
+    }
+}
+
+const Px* spxeStreamFrame(spxeStream* stream, unsigned long* seqptr)
+{
+    if (stream->fd != -1 && !spxeStreamReceive(stream)) {
+        close(stream->fd);
+        stream->fd = -1;
+    }
+
+    if (seqptr) {
+        *seqptr = stream->sequence;
+    }
+
+    return stream->fd != -1 && stream->sequence ? stream->frame : NULL;
+}
+
+void spxeStreamClose(spxeStream* stream)
+{
+    int i;
+    if (!stream) {
+        return;
+    }
+
+    for (i = 0; i < SPXE_STREAM_CLIENTS; ++i) {
+        if (stream->clients[i].fd != -1) {
+            spxeStreamDrop(stream->clients + i);
+        }
+    }
+    if (stream->fd != -1) {
+        close(stream->fd);
+    }
+    if (stream->path[0]) {
+        unlink(stream->path);
+    }
+
+    free(stream->frame);
+    free(stream->messages[0]);
+    free(stream->messages[1]);
+    free(stream->words);
+    free(stream->input);
+    free(stream);
+}
+
+#else /* !SPXE_POSIX */
+
+spxeStream* spxeStreamCreate(const char* address, const int width, const int height)
+{
+    (void)width;
+    (void)height;
+    fprintf(stderr, "spxe stream '%s' is not supported on this platform.\n", address);
+    return NULL;
+}
+
+unsigned long spxeStreamPublish(spxeStream* stream, const Px* pixbuf, const int stride)
+{
+    (void)stream;
+    (void)pixbuf;
+    (void)stride;
+    return 0;
+}
+
+spxeStream* spxeStreamOpen(const char* address)
+{
+    fprintf(stderr, "spxe stream '%s' is not supported on this platform.\n", address);
+    return NULL;
+}
+
+const Px* spxeStreamFrame(spxeStream* stream, unsigned long* seqptr)
+{
+    (void)stream;
+    if (seqptr) {
+        *seqptr = 0;
+    }
+    return NULL;
+}
+
+void spxeStreamClose(spxeStream* stream)
+{
+    (void)stream;
+}
+
+#endif /* SPXE_POSIX */
+
+int spxeStreamSize(spxeStream* stream, int* width, int* height)
+{
+    if (!stream) {
+        return 0;
+    }
+
+    *width = stream->width;
+    *height = stream->height;
+    return 1;
+}
+
+#endif /* SPXE_APPLICATION || SPXE_PRODUCER */
 #endif /* SIMPLE_PIXEL_ENGINE_H */
 
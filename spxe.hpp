@@ -0,0 +1,478 @@
+/*
+
+Copyright (c) 2023 Eugenio Arteaga A.
+
+Permission is hereby granted, free of charge, to any
+person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice
+shall be included in all copies or substantial portions
+of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef SIMPLE_PIXEL_ENGINE_HPP
+#define SIMPLE_PIXEL_ENGINE_HPP
+
+/******************
+****** spxe *******
+Simple PiXel Engine
+*******************
+*  C++ interface  *
+******************/
+
+/*
+Optional C++11 companion to spxe.h. It wraps the pixel buffer
+in a strided 2D view and provides fill, blit and transform
+kernels templated on the pixel format and the blend mode, so
+every combination is resolved at compile time and the inner
+loops are plain code the compiler can inline and vectorize.
+
+It includes spxe.h, so define SPXE_APPLICATION before including
+spxe.hpp in a single translation unit as you would with spxe.h.
+
+Px* pixbuf = spxeStart("spxe++", 800, 600, 200, 150);
+px::View<Px> screen = px::screen(pixbuf);
+px::fill(screen, px::rgba(0, 0, 0, 255));
+px::blit<px::Alpha>(screen, sprite, 10, 20);
+*/
+
+#if __cplusplus < 201103L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201103L)
+    #error "spxe.hpp requires C++11 or later"
+#endif
+
+#include "spxe.h"
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace px {
+
+/* pixel formats of the SPXE_FORMAT hint, Px being SPXE_RGBA8 */
+
+/* SPXE_RGBA16F, every channel holds the bits of a half float */
+struct Pxh {
+    unsigned short r, g, b, a;
+};
+
+/* SPXE_RGBA32F */
+struct Pxf {
+    float r, g, b, a;
+};
+
+/* pixel format traits */
+
+template <typename T>
+struct PxTraits;
+
+template <typename T>
+struct PxTraits<const T>: PxTraits<T> {};
+
+template <>
+struct PxTraits<Px> {
+    typedef unsigned char Channel;
+    static constexpr int channels = 4;
+    static constexpr int bits = 8;
+    static constexpr int alpha = 3;
+    static constexpr int format = SPXE_RGBA8;
+    static constexpr bool integer = true;
+};
+
+template <>
+struct PxTraits<Pxh> {
+    typedef unsigned short Channel;
+    static constexpr int channels = 4;
+    static constexpr int bits = 16;
+    static constexpr int alpha = 3;
+    static constexpr int format = SPXE_RGBA16F;
+    static constexpr bool integer = false;
+};
+
+template <>
+struct PxTraits<Pxf> {
+    typedef float Channel;
+    static constexpr int channels = 4;
+    static constexpr int bits = 32;
+    static constexpr int alpha = 3;
+    static constexpr int format = SPXE_RGBA32F;
+    static constexpr bool integer = false;
+};
+
+constexpr Px rgba(unsigned char r, unsigned char g, unsigned char b, unsigned char a = 255)
+{
+    return Px{r, g, b, a};
+}
+
+/* strided 2D view over a pixel buffer, stride is in pixels */
+
+template <typename T>
+class View {
+public:
+    typedef T Pixel;
+
+    constexpr View(): View(nullptr, 0, 0, 0) {}
+    constexpr View(T* data, int width, int height): View(data, width, height, width) {}
+
+    /* checked here and not in the class body, so overload resolution can
+    still name views of other types without instantiating the assert */
+    constexpr View(T* data, int width, int height, std::ptrdiff_t stride):
+        ptr(data), w(width), h(height), s(stride)
+    {
+        static_assert(
+            sizeof(T) == PxTraits<T>::channels * sizeof(typename PxTraits<T>::Channel),
+            "px::View needs a pixel format described by px::PxTraits"
+        );
+    }
+
+    /* only adds const, View<Px> converts to View<const Px> */
+    template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    constexpr View(const View<U>& view): View(view.data(), view.width(), view.height(), view.stride()) {}
+
+    constexpr T* data() const { return ptr; }
+    constexpr int width() const { return w; }
+    constexpr int height() const { return h; }
+    constexpr std::ptrdiff_t stride() const { return s; }
+    constexpr bool empty() const { return w <= 0 || h <= 0; }
+
+    constexpr T* row(int y) const { return ptr + s * y; }
+    constexpr T& operator()(int x, int y) const { return ptr[s * y + x]; }
+
+    /* sub view clipped against this view's bounds */
+    View sub(int x, int y, int width, int height) const
+    {
+        if (x < 0) {
+            width += x;
+            x = 0;
+        }
+        if (y < 0) {
+            height += y;
+            y = 0;
+        }
+        if (x + width > w) {
+            width = w - x;
+        }
+        if (y + height > h) {
+            height = h - y;
+        }
+        if (width <= 0 || height <= 0) {
+            return View();
+        }
+        return View(ptr + s * y + x, width, height, s);
+    }
+
+private:
+    T* ptr;
+    int w, h;
+    std::ptrdiff_t s;
+};
+
+/* view over the current spxe screen, T must match the SPXE_FORMAT hint */
+
+template <typename T = Px>
+inline View<T> screen(Px* pixbuf)
+{
+    int width, height;
+    spxeScreenSize(&width, &height);
+    return View<T>(reinterpret_cast<T*>(pixbuf), width, height, spxeStride());
+}
+
+/* blend modes */
+
+namespace detail {
+
+/* exact rounded division by 255 for values up to 255 * 255 */
+constexpr unsigned div255(unsigned x)
+{
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+constexpr unsigned char lerp(unsigned d, unsigned s, unsigned a)
+{
+    return (unsigned char)div255(s * a + d * (255 - a));
+}
+
+constexpr unsigned char sat(unsigned x)
+{
+    return (unsigned char)(x > 255 ? 255 : x);
+}
+
+/* exact, half floats are a subset of floats */
+inline float single(unsigned short h)
+{
+    const unsigned sign = (h & 0x8000u) << 16;
+    unsigned exp = (h >> 10) & 0x1f, mant = h & 0x3ff, bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000u | (mant << 13);
+    } else if (exp) {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    } else if (!mant) {
+        bits = sign;
+    } else {
+        for (exp = 113; !(mant & 0x400); --exp) {
+            mant <<= 1;
+        }
+        bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+constexpr unsigned char byte(float f)
+{
+    return (unsigned char)(f <= 0.0F ? 0 : f >= 1.0F ? 255 : f * 255.0F + 0.5F);
+}
+
+/* every format converts through Pxf */
+inline Pxf single(const Px& p)
+{
+    return Pxf{p.r / 255.0F, p.g / 255.0F, p.b / 255.0F, p.a / 255.0F};
+}
+
+inline Pxf single(const Pxh& p)
+{
+    return Pxf{single(p.r), single(p.g), single(p.b), single(p.a)};
+}
+
+inline Pxf single(const Pxf& p)
+{
+    return p;
+}
+
+template <typename T>
+T to(const Pxf& p);
+
+template <>
+inline Px to<Px>(const Pxf& p)
+{
+    return Px{byte(p.r), byte(p.g), byte(p.b), byte(p.a)};
+}
+
+template <>
+inline Pxh to<Pxh>(const Pxf& p)
+{
+    return Pxh{spxeHalf(p.r), spxeHalf(p.g), spxeHalf(p.b), spxeHalf(p.a)};
+}
+
+template <>
+inline Pxf to<Pxf>(const Pxf& p)
+{
+    return p;
+}
+
+} /* namespace detail */
+
+struct Copy {
+    template <typename T>
+    static T apply(const T& dst, const T& src)
+    {
+        (void)dst;
+        return src;
+    }
+};
+
+struct Alpha {
+    static Px apply(const Px& d, const Px& s)
+    {
+        return Px{
+            detail::lerp(d.r, s.r, s.a),
+            detail::lerp(d.g, s.g, s.a),
+            detail::lerp(d.b, s.b, s.a),
+            detail::sat((unsigned)s.a + detail::div255((unsigned)d.a * (255 - s.a)))
+        };
+    }
+
+    static Pxf apply(const Pxf& d, const Pxf& s)
+    {
+        const float t = 1.0F - s.a;
+        return Pxf{s.r * s.a + d.r * t, s.g * s.a + d.g * t, s.b * s.a + d.b * t, s.a + d.a * t};
+    }
+
+    static Pxh apply(const Pxh& d, const Pxh& s)
+    {
+        return detail::to<Pxh>(apply(detail::single(d), detail::single(s)));
+    }
+};
+
+struct Add {
+    static Px apply(const Px& d, const Px& s)
+    {
+        return Px{
+            detail::sat((unsigned)d.r + s.r),
+            detail::sat((unsigned)d.g + s.g),
+            detail::sat((unsigned)d.b + s.b),
+            detail::sat((unsigned)d.a + s.a)
+        };
+    }
+
+    /* float formats are not clamped, the tone mapping takes care of that */
+    static Pxf apply(const Pxf& d, const Pxf& s)
+    {
+        return Pxf{d.r + s.r, d.g + s.g, d.b + s.b, d.a + s.a};
+    }
+
+    static Pxh apply(const Pxh& d, const Pxh& s)
+    {
+        return detail::to<Pxh>(apply(detail::single(d), detail::single(s)));
+    }
+};
+
+struct Multiply {
+    static Px apply(const Px& d, const Px& s)
+    {
+        return Px{
+            (unsigned char)detail::div255((unsigned)d.r * s.r),
+            (unsigned char)detail::div255((unsigned)d.g * s.g),
+            (unsigned char)detail::div255((unsigned)d.b * s.b),
+            (unsigned char)detail::div255((unsigned)d.a * s.a)
+        };
+    }
+
+    static Pxf apply(const Pxf& d, const Pxf& s)
+    {
+        return Pxf{d.r * s.r, d.g * s.g, d.b * s.b, d.a * s.a};
+    }
+
+    static Pxh apply(const Pxh& d, const Pxh& s)
+    {
+        return detail::to<Pxh>(apply(detail::single(d), detail::single(s)));
+    }
+};
+
+/* kernels */
+
+template <typename T>
+void fill(View<T> dst, const T value)
+{
+    for (int y = 0; y < dst.height(); ++y) {
+        T* d = dst.row(y);
+        const int w = dst.width();
+        for (int x = 0; x < w; ++x) {
+            d[x] = value;
+        }
+    }
+}
+
+template <typename Blend, typename T>
+void fill(View<T> dst, const T value)
+{
+    for (int y = 0; y < dst.height(); ++y) {
+        T* d = dst.row(y);
+        const int w = dst.width();
+        for (int x = 0; x < w; ++x) {
+            d[x] = Blend::apply(d[x], value);
+        }
+    }
+}
+
+/* draws src with its bottom left corner at (x, y) of dst, clipping as needed */
+template <typename Blend, typename T>
+void blit(View<T> dst, View<const T> src, int x, int y)
+{
+    const View<T> to = dst.sub(x, y, src.width(), src.height());
+    if (to.empty()) {
+        return;
+    }
+
+    const int sx = x < 0 ? -x : 0;
+    const int sy = y < 0 ? -y : 0;
+    for (int j = 0; j < to.height(); ++j) {
+        T* d = to.row(j);
+        const T* s = src.row(j + sy) + sx;
+        const int w = to.width();
+        for (int i = 0; i < w; ++i) {
+            d[i] = Blend::apply(d[i], s[i]);
+        }
+    }
+}
+
+template <typename Blend, typename T>
+void blit(View<T> dst, View<T> src, int x, int y)
+{
+    blit<Blend, T>(dst, View<const T>(src), x, y);
+}
+
+template <typename T>
+void blit(View<T> dst, View<const T> src, int x, int y)
+{
+    blit<Copy, T>(dst, src, x, y);
+}
+
+template <typename T>
+void blit(View<T> dst, View<T> src, int x, int y)
+{
+    blit<Copy, T>(dst, View<const T>(src), x, y);
+}
+
+/* replaces every pixel by func(pixel) */
+template <typename T, typename Func>
+void transform(View<T> dst, Func func)
+{
+    for (int y = 0; y < dst.height(); ++y) {
+        T* d = dst.row(y);
+        const int w = dst.width();
+        for (int x = 0; x < w; ++x) {
+            d[x] = func(d[x]);
+        }
+    }
+}
+
+/* writes func(src pixel) to dst, both views must have the same size */
+template <typename T, typename U, typename Func>
+void transform(View<T> dst, View<const U> src, Func func)
+{
+    for (int y = 0; y < dst.height(); ++y) {
+        T* d = dst.row(y);
+        const U* s = src.row(y);
+        const int w = dst.width();
+        for (int x = 0; x < w; ++x) {
+            d[x] = func(s[x]);
+        }
+    }
+}
+
+/* writes src converted to the pixel format of dst, both views must have the same size */
+template <typename T, typename U>
+void convert(View<T> dst, View<const U> src)
+{
+    transform(dst, src, [](const U& p) { return detail::to<T>(detail::single(p)); });
+}
+
+template <typename T, typename U>
+void convert(View<T> dst, View<U> src)
+{
+    convert(dst, View<const U>(src));
+}
+
+/* writes func(x, y) to every pixel */
+template <typename T, typename Func>
+void generate(View<T> dst, Func func)
+{
+    for (int y = 0; y < dst.height(); ++y) {
+        T* d = dst.row(y);
+        const int w = dst.width();
+        for (int x = 0; x < w; ++x) {
+            d[x] = func(x, y);
+        }
+    }
+}
+
+} /* namespace px */
+
+#endif /* SIMPLE_PIXEL_ENGINE_HPP */
@@ -0,0 +1,74 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <stdio.h>
+#include <setjmp.h>
+
+#ifdef SPXE_DIRTY
+
+static sigjmp_buf pxJump;
+static volatile int pxFaults;
+
+/* a handler installed by the program before spxe, recovering from its own faults */
+static void pxFault(int sig, siginfo_t* info, void* context)
+{
+    (void)sig;
+    (void)info;
+    (void)context;
+    ++pxFaults;
+    siglongjmp(pxJump, 1);
+}
+
+int main(void)
+{
+    struct sigaction sa;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    unsigned char* tracked = (unsigned char*)mmap(
+        NULL, 4 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+    );
+    unsigned char* guard = (unsigned char*)mmap(
+        NULL, page, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+    );
+    if (tracked == MAP_FAILED || guard == MAP_FAILED) {
+        return 1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_sigaction = pxFault;
+    sa.sa_flags = SA_SIGINFO;
+    sigaction(SIGSEGV, &sa, NULL);
+    sigaction(SIGBUS, &sa, NULL);
+
+    spxeDirtyTrack(tracked, 4 * page, page);
+    spxeDirtyReset((const Px*)tracked);
+
+    /* a fault outside the tracked pages goes to the program's handler */
+    if (!sigsetjmp(pxJump, 1)) {
+        guard[0] = 1;
+    }
+    if (pxFaults != 1) {
+        printf("foreign fault was not passed on\n");
+        return 1;
+    }
+
+    /* and writes to tracked pages are still recorded afterwards */
+    tracked[2 * page + 5] = 1;
+    tracked[3 * page] = 1;
+    if (pxFaults != 1 || !spxed.touched || spxed.pages[0] || spxed.pages[1] ||
+        !spxed.pages[2] || !spxed.pages[3]) {
+        printf("tracked writes were not recorded after a foreign fault\n");
+        return 1;
+    }
+
+    spxeDirtyTrack(NULL, 0, 0);
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    return 0;
+}
+
+#endif /* SPXE_DIRTY */
@@ -0,0 +1,154 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <stdio.h>
+
+#define WIDTH 400
+#define HEIGHT 4
+#define SPREAD 8192
+#define CONV_W 37
+#define CONV_H 23
+#define CONV_R 3
+
+/* blurring a constant image must give back the same constant for any size */
+static int pxConstant(const Px* pixbuf, const Px color)
+{
+    int i;
+    for (i = 0; i < WIDTH * HEIGHT; ++i) {
+        if (pixbuf[i].r != color.r || pixbuf[i].g != color.g ||
+            pixbuf[i].b != color.b || pixbuf[i].a != color.a) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* variance of a blurred row around its mean, weighted by the red channel */
+static double pxSpread(const Px* row, const int width)
+{
+    int i;
+    double mass = 0.0, mean = 0.0, var = 0.0;
+    for (i = 0; i < width; ++i) {
+        mass += row[i].r;
+        mean += (double)row[i].r * i;
+    }
+    mean /= mass;
+    for (i = 0; i < width; ++i) {
+        var += row[i].r * (i - mean) * (i - mean);
+    }
+    return var / mass;
+}
+
+/* a bright pixel, or a block of them so wide blurs stay above 8 bit rounding,
+spreads by sigma squared on top of the block's own variance */
+static int pxGaussianSpread(void)
+{
+    int s, i, failed = 0;
+    static Px row[SPREAD], out[SPREAD];
+    const float sigmas[] = {0.5F, 1.0F, 2.0F, 2.9F, 3.0F, 5.0F, 10.0F, 50.0F, 100.0F, 200.0F};
+
+    for (s = 0; s < (int)(sizeof(sigmas) / sizeof(sigmas[0])); ++s) {
+        const float sigma = sigmas[s];
+        const int block = sigma < 4.0F ? 1 : (int)(4.0F * sigma) | 1;
+        const double expect = sigma * sigma + ((double)block * block - 1.0) / 12.0;
+        double var;
+
+        memset(row, 0, sizeof(row));
+        for (i = SPREAD / 2 - block / 2; i <= SPREAD / 2 + block / 2; ++i) {
+            row[i].r = 255;
+        }
+        spxeGaussianBlur(out, row, SPREAD, 1, SPREAD, sigma);
+        var = pxSpread(out, SPREAD);
+
+        /* the widths of the three boxes are odd integers, off by up to about sigma */
+        if (var - expect > 0.01 * expect + sigma || expect - var > 0.01 * expect + sigma) {
+            printf("spxeGaussianBlur sigma %.1f spreads %.2f instead of %.2f\n", sigma, var, expect);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+/* separable convolution against a direct one, both passes with edges repeated */
+static int pxConvolveDirect(void)
+{
+    int x, y, c, k;
+    static Px src[CONV_W * CONV_H], dst[CONV_W * CONV_H];
+    static double tmp[CONV_W * CONV_H * 4];
+    const float kernel[2 * CONV_R + 1] = {0.05F, -0.1F, 0.2F, 0.3F, 0.25F, 0.15F, 0.15F};
+
+    for (x = 0; x < CONV_W * CONV_H; ++x) {
+        src[x].r = (unsigned char)(x * 37);
+        src[x].g = (unsigned char)(x * x);
+        src[x].b = (unsigned char)(255 - x);
+        src[x].a = (unsigned char)(x * 101 + 7);
+    }
+    spxeConvolve(dst, src, CONV_W, CONV_H, CONV_W, kernel, CONV_R);
+
+    for (y = 0; y < CONV_H; ++y) {
+        for (x = 0; x < CONV_W; ++x) {
+            for (c = 0; c < 4; ++c) {
+                double sum = 0.0;
+                for (k = -CONV_R; k <= CONV_R; ++k) {
+                    const int i = x + k < 0 ? 0 : x + k >= CONV_W ? CONV_W - 1 : x + k;
+                    sum += kernel[k + CONV_R] * ((const unsigned char*)&src[y * CONV_W + i])[c];
+                }
+                tmp[(y * CONV_W + x) * 4 + c] = sum;
+            }
+        }
+    }
+
+    for (y = 0; y < CONV_H; ++y) {
+        for (x = 0; x < CONV_W; ++x) {
+            for (c = 0; c < 4; ++c) {
+                double sum = 0.5;
+                int got, want;
+                for (k = -CONV_R; k <= CONV_R; ++k) {
+                    const int j = y + k < 0 ? 0 : y + k >= CONV_H ? CONV_H - 1 : y + k;
+                    sum += kernel[k + CONV_R] * tmp[(j * CONV_W + x) * 4 + c];
+                }
+                want = sum < 0.0 ? 0 : sum > 255.0 ? 255 : (int)sum;
+                got = ((const unsigned char*)&dst[y * CONV_W + x])[c];
+                if (got - want > 1 || want - got > 1) {
+                    printf("spxeConvolve gives %d instead of %d at %d, %d\n", got, want, x, y);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    int i, r, failed = 0;
+    static Px src[WIDTH * HEIGHT], dst[WIDTH * HEIGHT];
+    const Px colors[3] = {{255, 255, 255, 255}, {0, 0, 0, 0}, {1, 128, 254, 77}};
+
+    for (i = 0; i < 3; ++i) {
+        int k;
+        for (k = 0; k < WIDTH * HEIGHT; ++k) {
+            src[k] = colors[i];
+        }
+
+        for (r = 1; r < 2000; ++r) {
+            spxeBoxBlur(dst, src, WIDTH, HEIGHT, WIDTH, r);
+            if (!pxConstant(dst, colors[i])) {
+                printf("spxeBoxBlur radius %d changed color %d\n", r, i);
+                failed = 1;
+            }
+        }
+
+        for (r = 1; r < 2000; r += 7) {
+            const float sigma = (float)r * 0.1F;
+            spxeGaussianBlur(dst, src, WIDTH, HEIGHT, WIDTH, sigma);
+            if (!pxConstant(dst, colors[i])) {
+                printf("spxeGaussianBlur sigma %.1f changed color %d\n", sigma, i);
+                failed = 1;
+            }
+        }
+    }
+
+    failed |= pxGaussianSpread();
+    failed |= pxConvolveDirect();
+    return failed;
+}
@@ -0,0 +1,105 @@
+#define SPXE_APPLICATION
+#define SPXE_HISTORY_KEYFRAMES 8
+#include <spxe.h>
+#include <stdio.h>
+
+#define WIDTH 48
+#define HEIGHT 32
+#define STRIDE 53
+#define FRAMES 120
+#define BUDGET 24000
+
+/* a fixed background, a block moving one pixel per frame and a pixel
+changing every frame, so deltas have runs, literals and both ends */
+static Px pxPixel(const int frame, const int x, const int y)
+{
+    Px p;
+    const int bx = frame % (WIDTH - 8), by = frame / 3 % (HEIGHT - 8);
+    p.r = (unsigned char)(x * 5);
+    p.g = (unsigned char)(y * 7);
+    p.b = (unsigned char)(x >= bx && x < bx + 8 && y >= by && y < by + 8 ? 255 - frame : 0);
+    p.a = (unsigned char)(x == WIDTH - 1 && y == HEIGHT - 1 ? frame : 255);
+    return p;
+}
+
+/* records through the same path as spxeStep(), waiting for the encoder so
+no frame is dropped */
+static void pxRecord(Px* pixbuf, const int frame)
+{
+    int x, y;
+    for (y = 0; y < HEIGHT; ++y) {
+        for (x = 0; x < WIDTH; ++x) {
+            pixbuf[y * STRIDE + x] = pxPixel(frame, x, y);
+        }
+    }
+
+    spxeh.frame = pixbuf;
+    spxeHistoryCapture();
+#ifdef SPXE_POSIX
+    pthread_mutex_lock(&spxeh.mutex);
+    while (spxeh.ready) {
+        pthread_cond_wait(&spxeh.done, &spxeh.mutex);
+    }
+    pthread_mutex_unlock(&spxeh.mutex);
+#endif
+}
+
+static int pxCheck(const int index, const int count)
+{
+    int x, y, width, height;
+    const int frame = FRAMES - 1 - index;
+    const Px* pixels = spxeHistoryFrame(index, &width, &height, NULL);
+    if (!pixels || width != WIDTH || height != HEIGHT) {
+        printf("history frame %d of %d missing\n", index, count);
+        return 1;
+    }
+
+    for (y = 0; y < HEIGHT; ++y) {
+        for (x = 0; x < WIDTH; ++x) {
+            const Px p = pxPixel(frame, x, y), q = pixels[y * WIDTH + x];
+            if (p.r != q.r || p.g != q.g || p.b != q.b || p.a != q.a) {
+                printf("history frame %d of %d differs at %d, %d\n", index, count, x, y);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    int i, count, failed = 0;
+    static Px pixbuf[STRIDE * HEIGHT];
+
+    spxe.scrres.width = WIDTH;
+    spxe.scrres.height = HEIGHT;
+    spxe.stride = STRIDE;
+    if (!spxeHistory(1000.0, BUDGET)) {
+        return 1;
+    }
+
+    for (i = 0; i < FRAMES; ++i) {
+        pxRecord(pixbuf, i);
+    }
+
+    /* the budget holds a few keyframe intervals, older ones were evicted */
+    count = spxeHistoryCount();
+    if (count <= SPXE_HISTORY_KEYFRAMES || count >= FRAMES || spxeHistoryDropped()) {
+        printf("history kept %d of %d frames, dropped %lu\n", count, FRAMES, spxeHistoryDropped());
+        failed = 1;
+    }
+
+    /* scrubbing back, forward and jumping around */
+    for (i = 0; i < count && !failed; ++i) {
+        failed = pxCheck(i, count);
+    }
+    for (i = count - 1; i >= 0 && !failed; --i) {
+        failed = pxCheck(i, count);
+    }
+    for (i = 0; i < count && !failed; ++i) {
+        failed = pxCheck(i * 7 % count, count);
+    }
+
+    spxeHistory(0.0, 0);
+    return failed;
+}
@@ -0,0 +1,120 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <stdio.h>
+
+#define PATH "/tmp/spxe-test-image.bin"
+#define WIDTH 4
+#define HEIGHT 3
+#define STRIDE 7
+#define PAD 0x5a
+
+/* a binary ppm with a comment in its header */
+static const unsigned char pxPpm[] = {
+    'P', '6', '\n', '#', ' ', 'x', '\n', '3', ' ', '2', '\n', '2', '5', '5', '\n',
+    1, 2, 3,    4, 5, 6,    7, 8, 9,
+    10, 11, 12, 13, 14, 15, 16, 17, 18
+};
+
+static const Px pxPpmPixels[2][3] = {
+    {{1, 2, 3, 255}, {4, 5, 6, 255}, {7, 8, 9, 255}},
+    {{10, 11, 12, 255}, {13, 14, 15, 255}, {16, 17, 18, 255}}
+};
+
+/* every qoi op, the runs and index lookups span across rows */
+static const unsigned char pxQoi[] = {
+    'q', 'o', 'i', 'f', 0, 0, 0, WIDTH, 0, 0, 0, HEIGHT, 4, 0,
+    0xfe, 10, 20, 30,       /* rgb */
+    0xc2,                   /* run of 3 */
+    0xff, 200, 100, 50, 128,/* rgba */
+    0x76,                   /* diff +1 -1 0 */
+    0xa5, 0x6a,             /* luma +3 +5 +7 */
+    0x09,                   /* index of the rgb pixel */
+    0x2a,                   /* index of the rgba pixel */
+    0xc2,                   /* run of 3 */
+    0, 0, 0, 0, 0, 0, 0, 1
+};
+
+static const Px pxQoiPixels[HEIGHT][WIDTH] = {
+    {{10, 20, 30, 255}, {10, 20, 30, 255}, {10, 20, 30, 255}, {10, 20, 30, 255}},
+    {{200, 100, 50, 128}, {201, 99, 50, 128}, {204, 104, 57, 128}, {10, 20, 30, 255}},
+    {{200, 100, 50, 128}, {200, 100, 50, 128}, {200, 100, 50, 128}, {200, 100, 50, 128}}
+};
+
+/* images are flipped while decoding, rows are stride apart and the padding
+between them is never written */
+static int pxCheck(const char* name, const Px* pixbuf, const Px* expect, const int w, const int h)
+{
+    int x, y;
+    const unsigned char* bytes = (const unsigned char*)pixbuf;
+    for (y = 0; y < HEIGHT; ++y) {
+        for (x = 0; x < STRIDE; ++x) {
+            const Px q = pixbuf[y * STRIDE + x];
+            if (x < w && y < h) {
+                const Px p = expect[(h - 1 - y) * w + x];
+                if (p.r != q.r || p.g != q.g || p.b != q.b || p.a != q.a) {
+                    printf("image: %s differs at %d, %d\n", name, x, y);
+                    return 1;
+                }
+            }
+            else if (bytes[(y * STRIDE + x) * sizeof(Px)] != PAD) {
+                printf("image: %s wrote padding at %d, %d\n", name, x, y);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    int w, h, failed = 0;
+    static Px pixbuf[STRIDE * HEIGHT];
+    spxeImage* image;
+    FILE* file = fopen(PATH, "wb");
+    if (!file) {
+        return 1;
+    }
+
+    /* a sequence of both formats */
+    fwrite(pxPpm, 1, sizeof(pxPpm), file);
+    fwrite(pxQoi, 1, sizeof(pxQoi), file);
+    fclose(file);
+
+    memset(pixbuf, PAD, sizeof(pixbuf));
+    if (!spxeImageRead(PATH, pixbuf, WIDTH, HEIGHT, STRIDE)) {
+        printf("image: ppm read failed\n");
+        failed = 1;
+    }
+    else failed |= pxCheck("ppm read", pixbuf, &pxPpmPixels[0][0], 3, 2);
+
+    image = spxeImageOpen(PATH);
+    if (!image) {
+        remove(PATH);
+        return 1;
+    }
+
+    memset(pixbuf, PAD, sizeof(pixbuf));
+    if (!spxeImageSize(image, &w, &h) || w != 3 || h != 2 ||
+        !spxeImageNext(image, pixbuf, WIDTH, HEIGHT, STRIDE)) {
+        printf("image: ppm in sequence failed\n");
+        failed = 1;
+    }
+    else failed |= pxCheck("ppm", pixbuf, &pxPpmPixels[0][0], 3, 2);
+
+    memset(pixbuf, PAD, sizeof(pixbuf));
+    if (!spxeImageSize(image, &w, &h) || w != WIDTH || h != HEIGHT ||
+        !spxeImageNext(image, pixbuf, WIDTH, HEIGHT, STRIDE)) {
+        printf("image: qoi in sequence failed\n");
+        failed = 1;
+    }
+    else failed |= pxCheck("qoi", pixbuf, &pxQoiPixels[0][0], WIDTH, HEIGHT);
+
+    if (spxeImageSize(image, &w, &h) || spxeImageNext(image, pixbuf, WIDTH, HEIGHT, STRIDE)) {
+        printf("image: sequence did not end\n");
+        failed = 1;
+    }
+
+    spxeImageClose(image);
+    remove(PATH);
+    return failed;
+}
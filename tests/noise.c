@@ -0,0 +1,53 @@
+#define SPXE_APPLICATION
+#include <spxe.h>
+#include <stdio.h>
+
+/* not a multiple of the chunk size nor of any thread count below */
+#define COUNT 100003
+#define SEED 1234
+
+/* fills with the given number of threads, restarting the workers */
+static void pxFill(unsigned int* out, const int threads, const unsigned int counter)
+{
+    spxeWorkersStop();
+    spxeHint(SPXE_THREADS, threads);
+    spxeRandomFill(out, COUNT, SEED, counter);
+}
+
+int main(void)
+{
+    int i, t, c, failed = 0;
+    static unsigned int single[COUNT], multi[COUNT];
+    const int threads[] = {2, 3, 7, 16};
+    /* the second counter wraps in the middle of the range */
+    const unsigned int counters[] = {0, 0xffffffffU - COUNT / 2};
+
+    for (c = 0; c < 2; ++c) {
+        pxFill(single, 1, counters[c]);
+        for (i = 0; i < COUNT; ++i) {
+            if (single[i] != spxeRandom(SEED, counters[c] + (unsigned int)i)) {
+                printf("noise: single thread fill differs from spxeRandom at %d\n", i);
+                failed = 1;
+                break;
+            }
+        }
+
+        for (t = 0; t < (int)(sizeof(threads) / sizeof(threads[0])); ++t) {
+            memset(multi, 0, sizeof(multi));
+            pxFill(multi, threads[t], counters[c]);
+#ifdef SPXE_POSIX
+            if (spxew.size != threads[t] - 1) {
+                printf("noise: started %d workers instead of %d\n", spxew.size, threads[t] - 1);
+                failed = 1;
+            }
+#endif
+            if (memcmp(single, multi, sizeof(multi))) {
+                printf("noise: fill with %d threads differs from one thread\n", threads[t]);
+                failed = 1;
+            }
+        }
+    }
+
+    spxeWorkersStop();
+    return failed;
+}
@@ -0,0 +1,125 @@
+#define SPXE_PRODUCER
+#include <spxe.h>
+#include <stdio.h>
+
+#ifdef SPXE_POSIX
+
+#include <signal.h>
+#include <sys/wait.h>
+
+#define WIDTH 64
+#define HEIGHT 64
+
+/* every frame is filled with its own sequence number, a copy with two
+different values in it was torn by the producer */
+static int pxUniform(const Px* frame, const unsigned long seq)
+{
+    int i;
+    for (i = 0; i < WIDTH * HEIGHT; ++i) {
+        if (frame[i].r != (unsigned char)seq || frame[i].g != (unsigned char)(seq >> 8)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void pxFill(Px* frame, const unsigned long seq)
+{
+    int i;
+    for (i = 0; i < WIDTH * HEIGHT; ++i) {
+        frame[i].r = (unsigned char)seq;
+        frame[i].g = (unsigned char)(seq >> 8);
+    }
+}
+
+int main(void)
+{
+    int i, failed = 0;
+    pid_t pid;
+    unsigned long seq, last = 0;
+    static Px copy[WIDTH * HEIGHT];
+    spxeShared* producer = spxeSharedCreate("spxe-test-shared", WIDTH, HEIGHT, 3);
+    spxeShared* viewer = spxeSharedOpen("spxe-test-shared");
+    if (!producer || !viewer) {
+        return 1;
+    }
+
+    if (spxeSharedFrame(viewer, &seq) || seq || spxeSharedCopy(viewer, copy, NULL)) {
+        fprintf(stderr, "shared: frame before the first publish\n");
+        failed = 1;
+    }
+
+    /* with three frames the newest one survives one more publish */
+    pxFill(spxeSharedBuffer(producer), 1);
+    spxeSharedPublish(producer);
+    spxeSharedFrame(viewer, &seq);
+    if (seq != 1 || !spxeSharedValid(viewer, seq)) {
+        fprintf(stderr, "shared: first frame is not valid\n");
+        failed = 1;
+    }
+
+    pxFill(spxeSharedBuffer(producer), 2);
+    spxeSharedPublish(producer);
+    if (!spxeSharedValid(viewer, seq)) {
+        fprintf(stderr, "shared: frame overwritten one publish early\n");
+        failed = 1;
+    }
+
+    pxFill(spxeSharedBuffer(producer), 3);
+    spxeSharedPublish(producer);
+    if (spxeSharedValid(viewer, seq)) {
+        fprintf(stderr, "shared: overwritten frame is still valid\n");
+        failed = 1;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        for (seq = 4; ; ++seq) {
+            pxFill(spxeSharedBuffer(producer), seq);
+            spxeSharedPublish(producer);
+        }
+    }
+
+    for (i = 0; i < 20000 && pid > 0; ++i) {
+        if (!spxeSharedCopy(viewer, copy, &seq) || seq < last || !pxUniform(copy, seq)) {
+            fprintf(stderr, "shared: torn copy of frame %lu\n", seq);
+            failed = 1;
+            break;
+        }
+        last = seq;
+    }
+
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+
+    /* across the wrap of the 32 bit sequence frames keep their slot order */
+    producer->header->sequence = 0xFFFFFFFFU - 0xFFFFFFFFU % 3 - 2;
+    for (i = 0; i < 5; ++i) {
+        const Px* frame;
+        unsigned long previous;
+        spxeSharedFrame(viewer, &previous);
+        pxFill(spxeSharedBuffer(producer), (unsigned long)i);
+        spxeSharedPublish(producer);
+        frame = spxeSharedFrame(viewer, &seq);
+        if (!frame || !seq || !pxUniform(frame, (unsigned long)i) ||
+            !spxeSharedValid(viewer, seq) || !spxeSharedValid(viewer, previous)) {
+            fprintf(stderr, "shared: frame %d lost across the sequence wrap\n", i);
+            failed = 1;
+        }
+    }
+
+    spxeSharedClose(viewer);
+    spxeSharedClose(producer);
+    return failed || pid <= 0;
+}
+
+#else
+
+int main(void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,166 @@
+#define SPXE_PRODUCER
+#include <spxe.h>
+#include <stdio.h>
+
+#ifdef SPXE_POSIX
+
+#include <pthread.h>
+
+/* not a multiple of the 32 pixel tiles, the last row and column are partial */
+#define WIDTH 100
+#define HEIGHT 70
+
+static char pxPath[64];
+static spxeStream* pxViewer;
+static volatile int pxOpened;
+
+static void* pxOpen(void* arg)
+{
+    (void)arg;
+    pxViewer = spxeStreamOpen(pxPath);
+    pxOpened = 1;
+    return NULL;
+}
+
+/* reads until the viewer has the frame with the given sequence */
+static int pxReceive(const Px* expect, const unsigned long sequence)
+{
+    int tries;
+    for (tries = 0; tries < 1000; ++tries) {
+        unsigned long seq;
+        const Px* frame = spxeStreamFrame(pxViewer, &seq);
+        if (frame && seq == sequence) {
+            return !memcmp(frame, expect, WIDTH * HEIGHT * sizeof(Px));
+        }
+        usleep(1000);
+    }
+    return 0;
+}
+
+static unsigned int pxRandom(void)
+{
+    static unsigned int state = 12345;
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+int main(void)
+{
+    int i, x, y, failed = 0;
+    pthread_t thread;
+    unsigned long seq;
+    const int small = 1, large = 1 << 20;
+    static Px frame[WIDTH * HEIGHT];
+    spxeStream* server;
+    FILE* file;
+
+    sprintf(pxPath, "/tmp/spxe-test-stream-%d", (int)getpid());
+
+    /* a file that is not a socket is never replaced */
+    file = fopen(pxPath, "w");
+    if (file) {
+        fclose(file);
+    }
+    server = spxeStreamCreate(pxPath, WIDTH, HEIGHT);
+    if (server || access(pxPath, F_OK)) {
+        fprintf(stderr, "stream: replaced a regular file\n");
+        spxeStreamClose(server);
+        failed = 1;
+    }
+    unlink(pxPath);
+
+    server = spxeStreamCreate(pxPath, WIDTH, HEIGHT);
+    if (!server || pthread_create(&thread, NULL, pxOpen, NULL)) {
+        return 1;
+    }
+    while (!pxOpened) {
+        spxeStreamAccept(server);
+        usleep(1000);
+    }
+    pthread_join(thread, NULL);
+    if (!pxViewer) {
+        spxeStreamClose(server);
+        return 1;
+    }
+
+    /* a new viewer starts from a keyframe */
+    for (i = 0; i < WIDTH * HEIGHT; ++i) {
+        frame[i].r = (unsigned char)(i % 7 ? 10 : i);
+        frame[i].g = (unsigned char)(i / WIDTH);
+        frame[i].a = 255;
+    }
+    seq = spxeStreamPublish(server, frame, WIDTH);
+    if (!pxReceive(frame, seq)) {
+        fprintf(stderr, "stream: keyframe decoded wrong\n");
+        failed = 1;
+    }
+
+    /* a few pixels inside one tile and a block across the partial corner tile */
+    frame[5 * WIDTH + 40].b = 200;
+    frame[6 * WIDTH + 41].b = 201;
+    for (y = 60; y < HEIGHT; ++y) {
+        for (x = 90; x < WIDTH; ++x) {
+            frame[y * WIDTH + x].r = (unsigned char)(x * y);
+        }
+    }
+    if (!server->clients[0].synced) {
+        fprintf(stderr, "stream: viewer not synced before a delta\n");
+        failed = 1;
+    }
+    seq = spxeStreamPublish(server, frame, WIDTH);
+    if (!pxReceive(frame, seq)) {
+        fprintf(stderr, "stream: delta decoded wrong\n");
+        failed = 1;
+    }
+
+    /* noise fills the small socket buffer, the frame after it is skipped */
+    setsockopt(server->clients[0].fd, SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    setsockopt(pxViewer->fd, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+    for (i = 0; i < WIDTH * HEIGHT; ++i) {
+        frame[i].r = (unsigned char)pxRandom();
+        frame[i].g = (unsigned char)pxRandom();
+        frame[i].b = (unsigned char)pxRandom();
+    }
+    spxeStreamPublish(server, frame, WIDTH);
+    if (!server->clients[0].size) {
+        fprintf(stderr, "stream: noise frame fit in the socket buffer\n");
+        failed = 1;
+    }
+    frame[0].r = (unsigned char)(frame[0].r + 1);
+    spxeStreamPublish(server, frame, WIDTH);
+    if (server->clients[0].synced) {
+        fprintf(stderr, "stream: busy viewer was sent a frame\n");
+        failed = 1;
+    }
+
+    /* once the backlog drains the viewer catches up with a keyframe */
+    setsockopt(server->clients[0].fd, SOL_SOCKET, SO_SNDBUF, &large, sizeof(large));
+    setsockopt(pxViewer->fd, SOL_SOCKET, SO_RCVBUF, &large, sizeof(large));
+    for (i = 0; i < 1000; ++i) {
+        unsigned long got;
+        const Px* last;
+        seq = spxeStreamPublish(server, frame, WIDTH);
+        last = spxeStreamFrame(pxViewer, &got);
+        if (last && got == seq && server->clients[0].synced) {
+            break;
+        }
+        usleep(1000);
+    }
+    if (!pxReceive(frame, seq)) {
+        fprintf(stderr, "stream: frame after the backlog decoded wrong\n");
+        failed = 1;
+    }
+
+    spxeStreamClose(pxViewer);
+    spxeStreamClose(server);
+    return failed;
+}
+
+#else
+
+int main(void)
+{
+    return 0;
+}
+
+#endif